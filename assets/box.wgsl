@@ -0,0 +1,54 @@
+// Bounding box of the chunk in the instance's slot, drawn as 36 vertices
+// generated from the vertex index. Used by the occlusion queries, which
+// only need its depth.
+struct UniformData {
+  proj: mat4x4f,
+  view: mat4x4f,
+  frustum: array<vec4f, 6>,
+  hizViewProj: mat4x4f,
+  hiz: vec4u,
+  camera: vec4f,
+}
+
+struct SSBOData {
+  origin: vec4i,
+  mesh: vec4u,
+  faces: vec4u,
+}
+
+@group(0) @binding(0) var<uniform> uUniform: UniformData;
+@group(0) @binding(1) var<storage, read> uSSBO: array<SSBOData>;
+
+const CHUNK_SIZE = 32.0;
+
+// Pushed outwards so a box never hides behind the terrain it bounds.
+const MARGIN = 0.05;
+
+// Corner of each triangle vertex, bit 0 set for max x, bit 1 for max y and
+// bit 2 for max z, two triangles per face.
+const CORNERS = array<u32, 36>(
+  0u, 2u, 6u, 0u, 6u, 4u,
+  1u, 5u, 7u, 1u, 7u, 3u,
+  0u, 4u, 5u, 0u, 5u, 1u,
+  2u, 3u, 7u, 2u, 7u, 6u,
+  0u, 1u, 3u, 0u, 3u, 2u,
+  4u, 6u, 7u, 4u, 7u, 5u,
+);
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32,
+           @builtin(instance_index) slot: u32) -> @builtin(position) vec4f {
+  let corner = CORNERS[index];
+  let pick = vec3f(vec3u(corner, corner >> 1u, corner >> 2u) & vec3u(1u));
+
+  // Blocks are centred on their integer coordinates.
+  let origin = vec3f(uSSBO[slot].origin.xyz) - 0.5 - MARGIN;
+  let position = origin + pick * (CHUNK_SIZE + 2.0 * MARGIN);
+
+  return uUniform.proj * uUniform.view * vec4f(position, 1.0);
+}
+
+@fragment
+fn fs_main() -> @location(0) vec4f {
+  return vec4f(0.0);
+}
@@ -0,0 +1,177 @@
+// Writes a DrawIndexedIndirect record for every chunk slot holding a mesh
+// that is reachable from the camera, intersects the view frustum and is not
+// hidden behind the previous frame's depth, compacted to the front of
+// uDraws. Each face direction of a chunk gets its own record, and
+// directions facing away from the camera get none.
+// uDrawCount must be cleared beforehand and the records past it zeroed, so
+// they can be drawn without the count.
+struct UniformData {
+  proj: mat4x4f,
+  view: mat4x4f,
+  frustum: array<vec4f, 6>,
+  hizViewProj: mat4x4f,
+  hiz: vec4u,
+  camera: vec4f,
+}
+
+struct SSBOData {
+  origin: vec4i,
+  mesh: vec4u,
+  faces: vec4u,
+}
+
+struct DrawIndexedIndirectArgs {
+  indexCount: u32,
+  instanceCount: u32,
+  firstIndex: u32,
+  baseVertex: i32,
+  firstInstance: u32,
+}
+
+@group(0) @binding(0) var<storage, read> uSSBO: array<SSBOData>;
+@group(0) @binding(1) var<storage, read_write> uDraws: array<DrawIndexedIndirectArgs>;
+@group(0) @binding(2) var<storage, read_write> uDrawCount: atomic<u32>;
+@group(0) @binding(3) var<uniform> uUniform: UniformData;
+@group(0) @binding(4) var uHiZ: texture_2d<f32>;
+// One bit per slot, set for chunks reachable through air from the camera
+// and not found occluded on the CPU or by the occlusion queries.
+@group(0) @binding(5) var<storage, read> uReachable: array<u32>;
+// Slots of the chunks with a mesh nearest first, padded with NO_SLOT.
+@group(0) @binding(6) var<storage, read> uOrder: array<u32>;
+
+const CHUNK_SIZE = 32.0;
+const NO_SLOT = 0xffffffffu;
+
+// Same test as Frustum::IntersectsBox, against the corner furthest along
+// each plane normal.
+fn intersectsFrustum(boxMin: vec3f, boxMax: vec3f) -> bool {
+  for (var i = 0u; i < 6u; i++) {
+    let plane = uUniform.frustum[i];
+    let corner = select(boxMin, boxMax, plane.xyz >= vec3f(0.0));
+    if (dot(plane.xyz, corner) + plane.w < 0.0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Same test as BlockGameApplication::FacesCamera. Faces pointing along +x
+// lie on planes past the box's min x, so they can only face a camera past
+// it, and so on. Faces come in opposite pairs, positive first.
+fn facesCamera(face: u32, boxMin: vec3f, boxMax: vec3f) -> bool {
+  let axis = face / 2u;
+  if ((face & 1u) == 0u) {
+    return uUniform.camera[axis] > boxMin[axis];
+  }
+
+  return uUniform.camera[axis] < boxMax[axis];
+}
+
+// Tests the box against the depth pyramid of the previous frame. The box is
+// projected with that frame's matrices and compared to the farthest depth
+// under its screen rectangle, read from the level where the rectangle
+// covers at most 2x2 texels.
+fn isOccluded(boxMin: vec3f, boxMax: vec3f) -> bool {
+  if (uUniform.hiz.x == 0u) {
+    return false;
+  }
+
+  var ndcMin = vec3f(1e30);
+  var ndcMax = vec3f(-1e30);
+
+  for (var i = 0u; i < 8u; i++) {
+    let pick = vec3<bool>((i & 1u) != 0u, (i & 2u) != 0u, (i & 4u) != 0u);
+    let clip = uUniform.hizViewProj * vec4f(select(boxMin, boxMax, pick), 1.0);
+
+    // Boxes reaching behind the camera cannot be tested.
+    if (clip.w <= 0.0) {
+      return false;
+    }
+
+    let ndc = clip.xyz / clip.w;
+    ndcMin = min(ndcMin, ndc);
+    ndcMax = max(ndcMax, ndc);
+  }
+
+  // Nothing is known about what was outside the previous view.
+  if (any(ndcMin.xy < vec2f(-1.0)) || any(ndcMax.xy > vec2f(1.0))) {
+    return false;
+  }
+
+  // NDC y points up, texture rows go down.
+  let uvMin = vec2f(ndcMin.x, -ndcMax.y) * 0.5 + 0.5;
+  let uvMax = vec2f(ndcMax.x, -ndcMin.y) * 0.5 + 0.5;
+
+  let rect = (uvMax - uvMin) * vec2f(uUniform.hiz.zw);
+  let level = min(u32(ceil(log2(max(max(rect.x, rect.y), 1.0)))),
+                  uUniform.hiz.y - 1u);
+
+  // Bounds at level 0 shifted down, not scaled to the level's size: odd
+  // sized levels fold their last row and column into the last texel of
+  // the next, see cs_downsample in hiz.wgsl, and the clamp lands there.
+  let size = uUniform.hiz.zw;
+  let levelSize = textureDimensions(uHiZ, level);
+  let baseMin = min(vec2u(uvMin * vec2f(size)), size - 1u);
+  let baseMax = min(vec2u(uvMax * vec2f(size)), size - 1u);
+  let texMin = min(baseMin >> vec2u(level), levelSize - 1u);
+  let texMax = min(baseMax >> vec2u(level), levelSize - 1u);
+
+  var depth = 0.0;
+  for (var y = texMin.y; y <= texMax.y; y++) {
+    for (var x = texMin.x; x <= texMax.x; x++) {
+      depth = max(depth, textureLoad(uHiZ, vec2u(x, y), level).r);
+    }
+  }
+
+  return ndcMin.z > depth;
+}
+
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3u) {
+  if (id.x >= arrayLength(&uOrder)) {
+    return;
+  }
+
+  // Invocations walk the chunks front to back, so records come out roughly
+  // in that order, exactly so within a workgroup on most hardware.
+  let slot = uOrder[id.x];
+  if (slot == NO_SLOT) {
+    return;
+  }
+
+  let quadCount = uSSBO[slot].mesh.x;
+  if (quadCount == 0u) {
+    return;
+  }
+
+  if (((uReachable[slot / 32u] >> (slot % 32u)) & 1u) == 0u) {
+    return;
+  }
+
+  // Blocks are centred on their integer coordinates, see vs_main.
+  let boxMin = vec3f(uSSBO[slot].origin.xyz) - 0.5;
+  let boxMax = boxMin + CHUNK_SIZE;
+  if (!intersectsFrustum(boxMin, boxMax) || isOccluded(boxMin, boxMax)) {
+    return;
+  }
+
+  // Quads are sorted by face, see SSBOData.
+  var firstQuad = 0u;
+
+  for (var face = 0u; face < 6u; face++) {
+    let count = (uSSBO[slot].faces[face / 2u] >> (16u * (face & 1u))) &
+                0xffffu;
+
+    if (count > 0u && facesCamera(face, boxMin, boxMax)) {
+      let index = atomicAdd(&uDrawCount, 1u);
+      let firstVertex = uSSBO[slot].mesh.y + firstQuad * 4u;
+
+      // The slot is passed as the instance index, as for direct draws.
+      uDraws[index] = DrawIndexedIndirectArgs(count * 6u, 1u, 0u,
+                                              i32(firstVertex), slot);
+    }
+
+    firstQuad += count;
+  }
+}
@@ -0,0 +1,50 @@
+// Builds the depth pyramid used by the occlusion test in cull.wgsl. Level 0
+// is a copy of the depth buffer, every further level holds the farthest
+// depth of the texels it covers in the level above, so a box nearer than a
+// texel is never hidden by it.
+
+@group(0) @binding(0) var uDepth: texture_depth_2d;
+@group(0) @binding(1) var uDst: texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_copy(@builtin(global_invocation_id) id: vec3u) {
+  let size = textureDimensions(uDst);
+  if (any(id.xy >= size)) {
+    return;
+  }
+
+  let depth = textureLoad(uDepth, id.xy, 0);
+  textureStore(uDst, id.xy, vec4f(depth, 0.0, 0.0, 0.0));
+}
+
+@group(0) @binding(0) var uSrc: texture_2d<f32>;
+
+@compute @workgroup_size(8, 8)
+fn cs_downsample(@builtin(global_invocation_id) id: vec3u) {
+  let size = textureDimensions(uDst);
+  if (any(id.xy >= size)) {
+    return;
+  }
+
+  let srcSize = textureDimensions(uSrc);
+  let base = id.xy * 2u;
+
+  // Odd sized levels fold their last row and column into the last texel.
+  var extent = vec2u(2u);
+  if (id.x == size.x - 1u && (srcSize.x & 1u) != 0u) {
+    extent.x = 3u;
+  }
+  if (id.y == size.y - 1u && (srcSize.y & 1u) != 0u) {
+    extent.y = 3u;
+  }
+
+  var depth = 0.0;
+  for (var y = 0u; y < extent.y; y++) {
+    for (var x = 0u; x < extent.x; x++) {
+      let coord = min(base + vec2u(x, y), srcSize - 1u);
+      depth = max(depth, textureLoad(uSrc, coord, 0).r);
+    }
+  }
+
+  textureStore(uDst, id.xy, vec4f(depth, 0.0, 0.0, 0.0));
+}
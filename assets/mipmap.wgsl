@@ -0,0 +1,30 @@
+// Downsamples one level of a texture into the next, see
+// Texture::GenerateMips. Sampling an sRGB view returns linear values and
+// the sRGB target encodes them again, so the average is taken in linear
+// space.
+
+struct VertexOutput {
+  @builtin(position) position: vec4f,
+  @location(0) uv: vec2f,
+}
+
+@group(0) @binding(0) var uSrc: texture_2d<f32>;
+@group(0) @binding(1) var uSampler: sampler;
+
+// One triangle covering the whole level.
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> VertexOutput {
+  let uv = vec2f(f32((index << 1u) & 2u), f32(index & 2u));
+
+  var out: VertexOutput;
+  out.position = vec4f(uv * vec2f(2.0, -2.0) + vec2f(-1.0, 1.0), 0.0, 1.0);
+  out.uv = uv;
+  return out;
+}
+
+// Halfway between the four source texels, so the linear filter averages
+// them.
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+  return textureSampleLevel(uSrc, uSampler, in.uv, 0.0);
+}
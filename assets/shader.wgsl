@@ -1,41 +1,58 @@
+// See ChunkVertex in include/mesher.h for the packing.
 struct VertexInput {
-  @location(0) position: vec4f,
-  @location(1) uv: vec2f,
+  @location(0) data: vec2u,
 }
 
 struct VertexOutput {
-  @builtin(position) position: vec4f,
+  // Invariant so the depth prepass variant computes the same depth.
+  @invariant @builtin(position) position: vec4f,
 
   @location(0) uv: vec2f,
+  @location(1) @interpolate(flat) layer: u32,
 }
 
 struct UniformData {
   proj: mat4x4f,
   view: mat4x4f,
+  frustum: array<vec4f, 6>,
+  hizViewProj: mat4x4f,
+  hiz: vec4u,
+  camera: vec4f,
 }
 
 struct SSBOData {
-  model: mat4x4f,
+  origin: vec4i,
+  mesh: vec4u,
+  faces: vec4u,
 }
 
 @group(0) @binding(0) var<uniform> uUniform: UniformData;
-@group(0) @binding(1) var<storage, read> uSSBO: SSBOData;
-@group(0) @binding(2) var texture: texture_2d<f32>;
+@group(0) @binding(1) var<storage, read> uSSBO: array<SSBOData>;
+@group(0) @binding(2) var texture: texture_2d_array<f32>;
+@group(0) @binding(3) var textureSampler: sampler;
 
 @vertex
-fn vs_main(in: VertexInput) -> VertexOutput {
+fn vs_main(in: VertexInput, @builtin(instance_index) slot: u32) -> VertexOutput {
+  let corner = vec3u(in.data.x, in.data.x >> 6u, in.data.x >> 12u) & vec3u(0x3fu);
+  let uv = vec2u(in.data.y, in.data.y >> 6u) & vec2u(0x3fu);
+  let block = (in.data.y >> 12u) & 0xffu;
+
+  // Blocks are centred on their integer coordinates.
+  let origin = vec3f(uSSBO[slot].origin.xyz);
+  let position = vec4f(origin + vec3f(corner) - 0.5, 1.0);
+
   var out: VertexOutput;
-  out.position = uUniform.proj * uUniform.view * uSSBO.model * in.position;
-  out.uv = in.uv;
+  out.position = uUniform.proj * uUniform.view * position;
+  out.uv = vec2f(uv);
+  // Air has no layer, the first one is BLOCK_COBBLESTONE's.
+  out.layer = block - 1u;
   return out;
 }
 
 @fragment
 fn fs_main(in: VertexOutput) -> @location(0) vec4f {
-  let texCoords = vec2i(in.uv * vec2f(textureDimensions(texture)));
-  let color = textureLoad(texture, texCoords, 0).rgb;
-  
-  // Gamma Correction
-  let linear_color = pow(color, vec3f(2.2));
-  return vec4f(linear_color, 1.0);
+  // Greedy quads carry UVs spanning several blocks, the sampler repeats
+  // the texture once per block. The sRGB texture returns linear color.
+  let color = textureSample(texture, textureSampler, in.uv, in.layer).rgb;
+  return vec4f(color, 1.0);
 }
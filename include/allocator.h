@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// First-fit allocator of ranges within a fixed capacity, used to place
+// variable sized chunk meshes in one shared buffer. Freed ranges are
+// merged with their free neighbours.
+class RangeAllocator {
+    public:
+	RangeAllocator() = default;
+	~RangeAllocator() = default;
+
+	void Create(uint32_t capacity);
+	void Release();
+
+	// Returns false when no free range is large enough.
+	bool Allocate(uint32_t size, uint32_t &offset);
+	void Free(uint32_t offset, uint32_t size);
+
+	inline uint32_t GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	inline uint32_t GetUsed() const
+	{
+		return m_used;
+	}
+
+    private:
+	uint32_t m_capacity = 0;
+	uint32_t m_used = 0;
+
+	// Free ranges, offset to size.
+	std::map<uint32_t, uint32_t> m_free;
+};
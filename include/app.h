@@ -1,8 +1,11 @@
 #pragma once
 
+#include "cache.h"
 #include "logger.h"
+#include "upload.h"
 #include "webgpu.h"
 #include "window.h"
+#include "workers.h"
 
 DECLARE_LOG_CATEGORY(WebGPU);
 
@@ -11,6 +14,19 @@ class Application {
 	Application() = default;
 	~Application() = default;
 
+	// Called before the device exists, to start CPU-side setup that
+	// needs no GPU on the workers, see WorkerPool::Start. The tasks may
+	// still run during Init, which waits for them with GetWorkers().Wait()
+	// before using their results.
+	virtual void Prepare()
+	{
+	}
+	// Raises the limits the device is requested with to what the
+	// application needs. Called from the adapter callback, which may run
+	// on any thread while the Prepare tasks do.
+	virtual void RequireLimits(wgpu::Limits &limits)
+	{
+	}
 	virtual void Init()
 	{
 	}
@@ -20,6 +36,11 @@ class Application {
 	virtual void Update(float deltaTime)
 	{
 	}
+	// Called before Update once the surface was configured with the new
+	// size of the window.
+	virtual void Resize(uint32_t width, uint32_t height)
+	{
+	}
 	virtual void Destroy()
 	{
 	}
@@ -59,6 +80,29 @@ class Application {
 		return m_format;
 	}
 
+	inline uint32_t GetSurfaceWidth() const
+	{
+		return m_surfaceWidth;
+	}
+
+	inline uint32_t GetSurfaceHeight() const
+	{
+		return m_surfaceHeight;
+	}
+
+	// Buffer and texture uploads go through the uploader, which submits
+	// them once per frame between Update and Render.
+	inline Uploader &GetUploader()
+	{
+		return m_uploader;
+	}
+
+	// Worker threads for parallel loops, shared by the whole application.
+	inline WorkerPool &GetWorkers()
+	{
+		return m_workers;
+	}
+
 	inline uint64_t GetMinSSBOStride()
 	{
 		return m_minSSBOStride;
@@ -67,10 +111,11 @@ class Application {
     private:
 	void InitWindow();
 	void InitInstance();
-	void InitAdapter();
+	wgpu::Future InitAdapter();
 	wgpu::Limits GetRequiredLimits();
 	void InitDevice();
 	void InitSurface();
+	void ConfigureSurface(uint32_t width, uint32_t height);
 
 	void Create();
 	void Loop(float deltaTime);
@@ -80,10 +125,19 @@ class Application {
 
     private:
 	Window m_window;
+	// Outlives the device, whose callbacks it serves.
+	BlobCache m_cache;
 	wgpu::Instance m_instance;
 	wgpu::Adapter m_adapter;
 	wgpu::Device m_device;
+	// Requested from the adapter callback, see InitAdapter.
+	wgpu::Future m_deviceFuture;
 	wgpu::Surface m_surface;
 	wgpu::TextureFormat m_format;
+	uint32_t m_surfaceWidth = 0;
+	uint32_t m_surfaceHeight = 0;
 	uint64_t m_minSSBOStride;
+
+	Uploader m_uploader;
+	WorkerPool m_workers;
 };
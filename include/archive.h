@@ -0,0 +1,74 @@
+#pragma once
+
+#include "logger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+DECLARE_LOG_CATEGORY(Assets);
+
+// Asset archive packed at build time by tools/packer.cpp. The header is
+// followed by the entries sorted by name, then the contents of every
+// entry, each 16-byte aligned and followed by a zero byte that its size
+// leaves out, so text assets can be used as C strings in place.
+struct ArchiveHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+};
+
+struct ArchiveEntry {
+	char name[48];
+	uint64_t offset;
+	uint64_t size;
+};
+
+static_assert(sizeof(ArchiveHeader) == 16);
+static_assert(sizeof(ArchiveEntry) == 64);
+
+constexpr uint32_t kArchiveMagic = 0x4b504742; // "BGPK"
+constexpr uint32_t kArchiveVersion = 1;
+constexpr uint64_t kArchiveAlignment = 16;
+
+// Read-only view of an asset archive. Native builds memory-map the file,
+// so opening it reads nothing and assets are paged in as they are used.
+// The Emscripten build reads the file from its preloaded file system
+// instead. Spans into the archive stay valid until Close.
+class AssetArchive {
+    public:
+	AssetArchive() = default;
+	~AssetArchive();
+
+	AssetArchive(const AssetArchive &other) = delete;
+	AssetArchive &operator=(const AssetArchive &other) = delete;
+
+	bool Open(const char *path);
+	void Close();
+
+	// Contents of an asset, empty when there is none by that name.
+	std::span<const uint8_t> Find(std::string_view name) const;
+
+	// Text asset as a zero terminated string, null when missing.
+	const char *FindText(std::string_view name) const;
+
+    private:
+	bool Validate();
+
+    private:
+	const uint8_t *m_data = nullptr;
+	size_t m_size = 0;
+
+	const ArchiveEntry *m_entries = nullptr;
+	uint32_t m_entryCount = 0;
+
+#if defined(__EMSCRIPTEN__)
+	std::vector<uint8_t> m_buffer;
+#elif defined(_WIN32)
+	void *m_file = nullptr;
+	void *m_mapping = nullptr;
+#endif
+};
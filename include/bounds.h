@@ -0,0 +1,42 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Axis-aligned chunk bounds indexed by chunk slot, stored as one array per
+// component so the frustum test can run on several boxes per instruction.
+// Uses AVX when compiled with it, otherwise SSE2, or WASM SIMD under
+// Emscripten, with a scalar fallback.
+class ChunkBounds {
+    public:
+	ChunkBounds() = default;
+	~ChunkBounds() = default;
+
+	void Create(uint32_t capacity);
+	void Release();
+
+	void Set(uint32_t slot, glm::vec3 min, glm::vec3 max);
+
+	// Tests every slot against the frustum, unused slots included.
+	void Cull(const Frustum &frustum);
+
+	inline bool IsVisible(uint32_t slot) const
+	{
+		return m_visible[slot] != 0;
+	}
+
+    private:
+	// Boxes processed per step of the widest enabled path; the arrays are
+	// padded to a multiple of it.
+	static constexpr uint32_t kLanes = 8;
+
+	uint32_t m_capacity = 0;
+
+	std::vector<float> m_minX, m_minY, m_minZ;
+	std::vector<float> m_maxX, m_maxY, m_maxZ;
+	std::vector<uint8_t> m_visible;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "logger.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+DECLARE_LOG_CATEGORY(Cache);
+
+// On-disk store for the blobs Dawn caches, mostly compiled shaders and
+// pipelines, so warm starts skip the backend compilers. Every blob is a
+// file named after the hash of its key, holding the key size, the key and
+// the blob, in a directory named after kCacheVersion. The callbacks may
+// run on any thread.
+class BlobCache {
+    public:
+	BlobCache() = default;
+	~BlobCache() = default;
+
+	BlobCache(const BlobCache &other) = delete;
+	BlobCache &operator=(const BlobCache &other) = delete;
+
+	// Returns false when the directory can't be created, the cache then
+	// misses every load and drops every store.
+	bool Create(const char *path);
+	void Release();
+
+	// Callbacks of wgpu::DawnCacheDeviceDescriptor, with the cache as
+	// userdata. Dawn first loads without a value to get the blob size,
+	// zero when there is none, then again into a buffer of that size.
+	static size_t LoadData(const void *key, size_t keySize, void *value,
+			       size_t valueSize, void *userdata);
+	static void StoreData(const void *key, size_t keySize,
+			      const void *value, size_t valueSize,
+			      void *userdata);
+
+	void LogStats() const;
+
+	// Bumped whenever the file layout changes, older caches are ignored.
+	static constexpr uint32_t kCacheVersion = 1;
+
+    private:
+	size_t Load(const void *key, size_t keySize, void *value,
+		    size_t valueSize);
+	void Store(const void *key, size_t keySize, const void *value,
+		   size_t valueSize);
+
+	std::filesystem::path GetPath(const void *key, size_t keySize) const;
+
+    private:
+	std::filesystem::path m_path;
+	bool m_enabled = false;
+
+	std::atomic<uint32_t> m_hits = 0;
+	std::atomic<uint32_t> m_misses = 0;
+	std::atomic<uint32_t> m_stores = 0;
+	std::atomic<uint64_t> m_loadedBytes = 0;
+	std::atomic<uint64_t> m_storedBytes = 0;
+};
@@ -34,6 +34,30 @@ class Config {
 		return m_title;
 	}
 
+	// Whether terrain starts out drawn with a depth prepass, see
+	// RenderPipeline::GetPrepassPipeline.
+	inline void SetDepthPrepass(bool depthPrepass)
+	{
+		m_depthPrepass = depthPrepass;
+	}
+
+	inline bool GetDepthPrepass() const
+	{
+		return m_depthPrepass;
+	}
+
+	// GPU time in milliseconds dynamic resolution scales the render size
+	// to stay within, see DynamicResolution.
+	inline void SetTargetFrameTime(float targetFrameTime)
+	{
+		m_targetFrameTime = targetFrameTime;
+	}
+
+	inline float GetTargetFrameTime() const
+	{
+		return m_targetFrameTime;
+	}
+
     private:
 	Config()
 	{
@@ -49,4 +73,6 @@ class Config {
 	int m_width;
 	int m_height;
 	const char *m_title;
+	bool m_depthPrepass = false;
+	float m_targetFrameTime = 1000.0f / 60.0f;
 };
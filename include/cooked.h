@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Texture array cooked at build time by the asset cooker, see
+// tools/cooker.cpp. The header is followed by every level of the first
+// layer, largest first, then every level of the next layer and so on.
+// Levels are RGBA8 sRGB texels in tightly packed rows, bottom row first as
+// stb_image loads them flipped.
+struct CookedTextureHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t layerCount;
+	uint32_t mipCount;
+};
+
+static_assert(sizeof(CookedTextureHeader) == 6 * sizeof(uint32_t));
+
+constexpr uint32_t kCookedTextureMagic = 0x58544742; // "BGTX"
+constexpr uint32_t kCookedTextureVersion = 1;
+
+inline uint32_t GetCookedLevelSize(const CookedTextureHeader &header,
+				   uint32_t level)
+{
+	uint32_t width = header.width >> level;
+	uint32_t height = header.height >> level;
+	return 4 * (width > 0 ? width : 1) * (height > 0 ? height : 1);
+}
+
+inline size_t GetCookedLayerSize(const CookedTextureHeader &header)
+{
+	size_t size = 0;
+	for (uint32_t level = 0; level < header.mipCount; level++) {
+		size += GetCookedLevelSize(header, level);
+	}
+
+	return size;
+}
+
+// Checks the header and size of a cooked texture, data is the whole file.
+inline bool IsCookedTextureValid(const void *data, size_t size)
+{
+	if (size < sizeof(CookedTextureHeader)) {
+		return false;
+	}
+
+	const auto &header = *static_cast<const CookedTextureHeader *>(data);
+
+	return header.magic == kCookedTextureMagic &&
+	       header.version == kCookedTextureVersion && header.width > 0 &&
+	       header.height > 0 &&
+	       header.mipCount > 0 && header.mipCount <= 32 &&
+	       size == sizeof(CookedTextureHeader) +
+			       GetCookedLayerSize(header) * header.layerCount;
+}
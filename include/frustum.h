@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+enum FrustumPlane {
+	PLANE_LEFT = 0,
+	PLANE_RIGHT,
+	PLANE_BOTTOM,
+	PLANE_TOP,
+	PLANE_NEAR,
+	PLANE_FAR,
+	PLANE_COUNT,
+};
+
+// View frustum as six inward facing planes, xyz the normal and w the
+// distance, so that dot(plane.xyz, p) + plane.w >= 0 inside.
+struct Frustum {
+	glm::vec4 planes[PLANE_COUNT];
+
+	// Extracts the planes of a combined projection and view matrix.
+	static Frustum FromMatrix(const glm::mat4 &viewProj);
+
+	// A frustum that contains everything, for when culling is disabled.
+	static Frustum Infinite();
+
+	// Conservative test, boxes near a frustum corner may pass while being
+	// outside.
+	bool IntersectsBox(glm::vec3 min, glm::vec3 max) const;
+};
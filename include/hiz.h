@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pipeline.h"
+#include "webgpu.h"
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical-Z pyramid of a depth buffer, an R32Float texture whose mip
+// levels each hold the farthest depth of the texels they cover. It is
+// built at the end of a frame and tested against by the cull pass of the
+// next one.
+class DepthPyramid {
+    public:
+	DepthPyramid() = default;
+	~DepthPyramid() = default;
+
+	// The depth view must come from a texture with TextureBinding usage
+	// and the given size. The pipelines compile in the background, see
+	// Wait.
+	void Create(wgpu::Device &device, const char *src,
+		    const wgpu::TextureView &depthView, uint32_t width,
+		    uint32_t height);
+	void Release();
+
+	// Blocks until the pipelines started by Create are compiled.
+	void Wait(wgpu::Instance &instance);
+
+	// Recreates the pyramid for a resized depth buffer, keeping the
+	// pipelines.
+	void Resize(wgpu::Device &device, const wgpu::TextureView &depthView,
+		    uint32_t width, uint32_t height);
+
+	// Records the compute passes that rebuild every level.
+	void Build(wgpu::CommandEncoder &encoder);
+
+	// View of the whole mip chain, for sampling.
+	inline wgpu::TextureView &GetView()
+	{
+		return m_view;
+	}
+
+	inline uint32_t GetMipCount() const
+	{
+		return m_mipCount;
+	}
+
+	inline uint32_t GetWidth() const
+	{
+		return m_width;
+	}
+
+	inline uint32_t GetHeight() const
+	{
+		return m_height;
+	}
+
+    private:
+	wgpu::TextureView CreateLevelView(uint32_t level);
+
+    private:
+	ComputePipeline m_copyPipeline;
+	ComputePipeline m_downsamplePipeline;
+
+	wgpu::Texture m_texture;
+	wgpu::TextureView m_view;
+
+	// One per level, level 0 reads the depth buffer.
+	std::vector<wgpu::BindGroup> m_bindGroups;
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_mipCount = 0;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "world.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#define PADDED_CHUNK_SIZE (CHUNK_SIZE + 2)
+
+enum Face {
+	FACE_POS_X = 0,
+	FACE_NEG_X,
+	FACE_POS_Y,
+	FACE_NEG_Y,
+	FACE_POS_Z,
+	FACE_NEG_Z,
+	FACE_COUNT,
+};
+
+enum MeshingMode {
+	// One quad per exposed block face.
+	MESHING_CULLED = 0,
+	// Exposed faces of the same block type merged into maximal
+	// rectangles per slice, with UVs spanning the rectangle so the
+	// texture tiles once per block.
+	MESHING_GREEDY,
+	// Merged mesh equivalent to MESHING_GREEDY's, covering the same
+	// faces though the rectangles may be split differently. Computed on
+	// 64-bit occupancy columns with shifts, masks and count-trailing-zeros
+	// instead of visiting every block.
+	MESHING_BINARY,
+};
+
+// Chunk mesh vertex packed into two words, decoded in vs_main:
+//   position: corner x, y, z (6 bits each, 0..CHUNK_SIZE), face (3 bits)
+//   texture:  uv u, v (6 bits each, in blocks), block type (8 bits)
+struct ChunkVertex {
+	uint32_t position;
+	uint32_t texture;
+
+	static inline ChunkVertex Pack(glm::ivec3 corner, Face face,
+				       glm::ivec2 uv, Block type)
+	{
+		return ChunkVertex{
+			.position = uint32_t(corner.x) |
+				    (uint32_t(corner.y) << 6) |
+				    (uint32_t(corner.z) << 12) |
+				    (uint32_t(face) << 18),
+			.texture = uint32_t(uv.x) | (uint32_t(uv.y) << 6) |
+				   (uint32_t(type) << 12),
+		};
+	}
+};
+
+static_assert(sizeof(ChunkVertex) == 2 * sizeof(uint32_t));
+static_assert(CHUNK_SIZE < 64);
+
+// Connectivity of a chunk's faces through the air inside it, bit
+// a * FACE_COUNT + b is set when faces a and b are connected. Both
+// orders are set.
+#define VISIBILITY_ALL ((uint64_t(1) << (FACE_COUNT * FACE_COUNT)) - 1)
+
+static inline bool IsFaceConnected(uint64_t visibility, int a, int b)
+{
+	return (visibility >> (a * FACE_COUNT + b)) & 1;
+}
+
+struct ChunkMesh {
+	std::vector<ChunkVertex> vertices;
+	uint64_t visibility = 0;
+	// Quads facing each direction. Vertices are sorted by face in Face
+	// order, so every direction is a contiguous range that can be drawn
+	// or skipped on its own.
+	uint32_t faceQuads[FACE_COUNT] = {};
+
+	// Every face is a quad of four vertices, drawn with the shared index
+	// pattern from Mesher::GetQuadIndices.
+	inline uint32_t GetQuadCount() const
+	{
+		return vertices.size() / 4;
+	}
+
+	inline void Clear()
+	{
+		vertices.clear();
+		visibility = 0;
+		std::fill(std::begin(faceQuads), std::end(faceQuads), 0);
+	}
+};
+
+class Mesher {
+    public:
+	Mesher();
+	~Mesher() = default;
+
+	// Builds the mesh of a chunk, emitting only the faces that border
+	// air. Faces on the chunk border look into the neighbouring chunks,
+	// which are treated as air while they are not loaded. Also fills in
+	// the chunk's face connectivity.
+	void Mesh(const World &world, const Chunk &chunk, ChunkMesh &mesh);
+
+	static glm::ivec3 GetFaceNormal(Face face);
+
+	inline MeshingMode GetMode() const
+	{
+		return m_mode;
+	}
+
+	inline void SetMode(MeshingMode mode)
+	{
+		m_mode = mode;
+	}
+
+	static std::vector<uint32_t> GetQuadIndices(uint32_t quadCount);
+
+    private:
+	static inline int GetPaddedIdx(int x, int y, int z)
+	{
+		return z + PADDED_CHUNK_SIZE * (y + PADDED_CHUNK_SIZE * x);
+	}
+
+	inline Block GetPadded(glm::ivec3 pos) const
+	{
+		return m_padded[GetPaddedIdx(pos.x + 1, pos.y + 1, pos.z + 1)];
+	}
+
+	void Gather(const World &world, const Chunk &chunk);
+
+	void MeshCulled(const Chunk &chunk, ChunkMesh &mesh);
+	void MeshGreedy(ChunkMesh &mesh);
+
+	void BuildMask(Face face, int slice);
+	void MergeMask(ChunkMesh &mesh, Face face, int slice);
+
+	inline uint64_t &GetColumn(int axis, int a, int b)
+	{
+		return m_columns[(axis * PADDED_CHUNK_SIZE + a) *
+					 PADDED_CHUNK_SIZE +
+				 b];
+	}
+
+	inline uint32_t *GetPlane(int slot, int face, int slice)
+	{
+		return &m_planes[((slot * FACE_COUNT + face) * CHUNK_SIZE +
+				  slice) *
+				 CHUNK_SIZE];
+	}
+
+	void BuildColumns(const World &world, const Chunk &chunk);
+	void AddFace(const Chunk &chunk, int face, int slice, int a, int b);
+	void ScatterFaces(const Chunk &chunk, int face, int a,
+			  const uint32_t visible[32]);
+	void BuildPlanes(const Chunk &chunk);
+	void MergePlane(ChunkMesh &mesh, Face face, Block type, int slice,
+			uint32_t *plane);
+	void MeshBinary(const World &world, const Chunk &chunk,
+			ChunkMesh &mesh);
+
+	// Flood fills the air of the chunk one connected region at a time,
+	// on whole columns of bits, and records which faces each region
+	// touches.
+	void BuildVisibility(const Chunk &chunk, ChunkMesh &mesh);
+	// Grows m_region by one block sideways and along whole runs of air
+	// vertically, returns whether it changed.
+	bool GrowRegion(bool backward);
+	bool GrowColumn(int x, int z);
+	// Connects the faces the region touches and removes it from m_air.
+	void AddRegion(ChunkMesh &mesh);
+
+	// Groups the quads of the mesh by face and fills in faceQuads.
+	void SortByFace(ChunkMesh &mesh);
+
+	void EmitQuad(ChunkMesh &mesh, Face face, Block type, glm::ivec3 pos);
+	void EmitQuad(ChunkMesh &mesh, Face face, Block type, int slice, int u,
+		      int v, int width, int height);
+
+    private:
+	MeshingMode m_mode = MESHING_CULLED;
+
+	// The chunk's blocks plus a one block border taken from its
+	// neighbours, indexed with GetPaddedIdx.
+	std::vector<Block> m_padded;
+
+	// Per-slice face mask used by greedy meshing, holding the block type
+	// of each visible face or BLOCK_AIR.
+	std::vector<Block> m_mask;
+
+	// Padded occupancy columns along x, y and z used by binary meshing.
+	// Bit i of a column is set when the block at padded coordinate i
+	// along that axis is solid.
+	std::vector<uint64_t> m_columns;
+
+	// Visible face bitmasks per block type, face and slice, one 32-bit
+	// row per block along the slice's first axis.
+	std::vector<uint32_t> m_planes;
+	// Bitmask of the non-empty slices per block type and face.
+	std::vector<uint32_t> m_slices;
+	std::vector<Block> m_slotTypes;
+	int m_typeSlots[256];
+
+	// Vertices of the mesh being sorted by SortByFace.
+	std::vector<ChunkVertex> m_sorted;
+
+	// Air not yet assigned to a region and the region being filled, one
+	// y column per (x, z) as in Chunk::GetColumn.
+	std::vector<uint32_t> m_air;
+	std::vector<uint32_t> m_region;
+	// Bounds of the region's columns in x and z.
+	glm::ivec2 m_regionMin, m_regionMax;
+};
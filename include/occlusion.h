@@ -0,0 +1,89 @@
+#pragma once
+
+#include "logger.h"
+#include "pipeline.h"
+#include "upload.h"
+#include "webgpu.h"
+
+#include <cstdint>
+#include <vector>
+
+DECLARE_LOG_CATEGORY(Occlusion);
+
+// Hardware occlusion queries against chunk bounding boxes. The boxes of
+// the chunks to test are drawn after the terrain, depth tested but not
+// written, one query each. The results are resolved into a buffer and
+// read back asynchronously, so they arrive a frame or more after they
+// were issued and are applied to the frames after that.
+//
+// Chunks reported occluded keep being queried every frame, so they are
+// drawn again as soon as a query sees any of their box.
+class OcclusionQueries {
+    public:
+	OcclusionQueries() = default;
+	~OcclusionQueries() = default;
+
+	// The box pipeline is created against the chunk pipeline's layout
+	// and formats, so it shares its bind group and render pass. It
+	// compiles in the background, see Wait.
+	void Create(wgpu::Device &device, const char *src,
+		    RenderPipeline &pipeline, uint32_t slotCount);
+	void Release();
+
+	// Blocks until the box pipeline started by Create is compiled.
+	void Wait(wgpu::Instance &instance);
+
+	// Starts the queries of a frame, returns false when every readback
+	// buffer is still in flight and no queries can be issued.
+	bool Begin();
+
+	// Draws the box of the chunk in the slot inside its own query. The
+	// box pipeline must be set, see GetPipeline.
+	void Issue(wgpu::RenderPassEncoder &pass, uint32_t slot);
+
+	// Records the resolve and copy of the issued queries.
+	void Resolve(wgpu::CommandEncoder &encoder);
+
+	// Maps the results once the commands of Resolve were submitted.
+	void Read();
+
+	// Forgets the result of a slot, for when it is given to a new chunk.
+	void Invalidate(uint32_t slot);
+
+	inline bool IsOccluded(uint32_t slot) const
+	{
+		return m_occluded[slot] != 0;
+	}
+
+	inline wgpu::QuerySet &GetQuerySet()
+	{
+		return m_querySet;
+	}
+
+	inline wgpu::RenderPipeline &GetPipeline()
+	{
+		return m_pipeline;
+	}
+
+    private:
+	// Slots queried into a buffer of the readback ring, in query order.
+	struct Readback {
+		std::vector<uint32_t> slots;
+		std::vector<uint32_t> generations;
+	};
+
+	static constexpr uint32_t kReadbackCount = 3;
+
+    private:
+	wgpu::RenderPipeline m_pipeline;
+	std::vector<wgpu::Future> m_futures;
+	wgpu::QuerySet m_querySet;
+	wgpu::Buffer m_resolveBuffer;
+
+	ReadbackRing m_ring;
+	std::vector<Readback> m_readbacks;
+
+	std::vector<uint8_t> m_occluded;
+	// Bumped by Invalidate, results issued under an older one are dropped.
+	std::vector<uint32_t> m_generations;
+};
@@ -1,17 +1,51 @@
 #pragma once
 
+#include "logger.h"
 #include "webgpu.h"
 
+#include <cstdint>
+#include <vector>
+
+DECLARE_LOG_CATEGORY(Pipeline);
+
+// Starts compiling a render pipeline in the background. The descriptor is
+// copied by the call, the pipeline lands in target once the future
+// completed, see WaitForPipelines.
+wgpu::Future CreatePipelineAsync(wgpu::Device &device,
+				 const wgpu::RenderPipelineDescriptor &desc,
+				 wgpu::RenderPipeline &target);
+wgpu::Future CreatePipelineAsync(wgpu::Device &device,
+				 const wgpu::ComputePipelineDescriptor &desc,
+				 wgpu::ComputePipeline &target);
+
+// Blocks until the pipelines of the futures are compiled, and clears them.
+void WaitForPipelines(wgpu::Instance &instance,
+		      std::vector<wgpu::Future> &futures);
+
 class RenderPipeline {
     public:
 	RenderPipeline() = default;
 	~RenderPipeline() = default;
 
+	// Starts compiling the pipelines in the background. The layouts and
+	// the depth buffer are ready right away, the pipelines once Wait
+	// returned.
 	void Create(wgpu::Device &device, const char *src,
 		    wgpu::TextureFormat format);
 
+	// Blocks until the pipelines started by Create are compiled.
+	void Wait(wgpu::Instance &instance);
+
 	void Release();
 
+	// Recreates the depth buffer with a new size, Create makes it as large
+	// as the configured window.
+	void Resize(wgpu::Device &device, uint32_t width, uint32_t height);
+
+	// Creates an encoder for render bundles that can be executed in the
+	// passes this pipeline draws into.
+	wgpu::RenderBundleEncoder CreateBundleEncoder(wgpu::Device &device);
+
 	inline wgpu::BindGroupLayout &GetBindGroupLayout()
 	{
 		return m_bindGroupLayout;
@@ -27,6 +61,29 @@ class RenderPipeline {
 		return m_pipeline;
 	}
 
+	// Depth only variant for a prepass without color attachments.
+	inline wgpu::RenderPipeline &GetPrepassPipeline()
+	{
+		return m_prepassPipeline;
+	}
+
+	// Variant for the color pass after a prepass, which shades only the
+	// fragments whose depth equals the prepass result and writes no depth.
+	inline wgpu::RenderPipeline &GetEqualPipeline()
+	{
+		return m_equalPipeline;
+	}
+
+	inline wgpu::TextureFormat GetFormat() const
+	{
+		return m_format;
+	}
+
+	inline wgpu::TextureFormat GetDepthStencilFormat() const
+	{
+		return m_depthStencilFormat;
+	}
+
 	inline wgpu::Texture GetDepthStencil()
 	{
 		return m_depthStencil;
@@ -38,9 +95,50 @@ class RenderPipeline {
 	}
 
     private:
+	wgpu::TextureFormat m_format;
+	wgpu::TextureFormat m_depthStencilFormat;
+
 	wgpu::BindGroupLayout m_bindGroupLayout;
 	wgpu::PipelineLayout m_layout;
 	wgpu::RenderPipeline m_pipeline;
+	wgpu::RenderPipeline m_prepassPipeline;
+	wgpu::RenderPipeline m_equalPipeline;
+	std::vector<wgpu::Future> m_futures;
 	wgpu::Texture m_depthStencil;
 	wgpu::TextureView m_depthStencilView;
 };
+
+// Compute pipeline with a single bind group of the given layout, bind
+// groups are created against GetBindGroupLayout().
+class ComputePipeline {
+    public:
+	ComputePipeline() = default;
+	~ComputePipeline() = default;
+
+	// Starts compiling the pipeline in the background. The layout is
+	// ready right away, the pipeline once Wait returned.
+	void Create(wgpu::Device &device, const char *src,
+		    const char *entryPoint,
+		    const std::vector<wgpu::BindGroupLayoutEntry> &entries);
+
+	// Blocks until the pipeline started by Create is compiled.
+	void Wait(wgpu::Instance &instance);
+
+	void Release();
+
+	inline wgpu::BindGroupLayout &GetBindGroupLayout()
+	{
+		return m_bindGroupLayout;
+	}
+
+	inline wgpu::ComputePipeline &GetPipeline()
+	{
+		return m_pipeline;
+	}
+
+    private:
+	wgpu::BindGroupLayout m_bindGroupLayout;
+	wgpu::PipelineLayout m_layout;
+	wgpu::ComputePipeline m_pipeline;
+	std::vector<wgpu::Future> m_futures;
+};
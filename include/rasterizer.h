@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mesher.h"
+#include "workers.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Large face of a chunk mesh in world space, corners in order around it.
+struct OccluderQuad {
+	glm::vec3 corners[4];
+};
+
+// Software occlusion culling against a low resolution depth buffer. The
+// largest faces of the nearby chunks are rasterized on the CPU, then
+// chunk boxes are tested against the result in the same frame, so unlike
+// the GPU paths there is no latency and nothing to read back.
+//
+// Occluders only cover the pixels they cover entirely and store their
+// farthest depth over each pixel, so the buffer never claims more than
+// the occluders hide. Each worker rasterizes a band of tile rows, four
+// pixels per step with SSE2 or WASM SIMD, with a scalar fallback. Every
+// tile keeps its farthest depth so most boxes are decided per tile.
+class OcclusionRasterizer {
+    public:
+	OcclusionRasterizer() = default;
+	~OcclusionRasterizer() = default;
+
+	// Width must be a multiple of kTileWidth and height of kTileHeight.
+	void Create(uint32_t width, uint32_t height);
+	void Release();
+
+	// Starts a frame seen through the given projection and view matrix.
+	void Begin(const glm::mat4 &viewProj);
+
+	// Occluders reaching behind the near plane are skipped.
+	void AddOccluder(const OccluderQuad &quad);
+
+	void Rasterize(WorkerPool &workers);
+
+	bool IsOccluded(glm::vec3 min, glm::vec3 max) const;
+
+	inline uint32_t GetOccluderCount() const
+	{
+		return m_occluders.size();
+	}
+
+	// Picks the faces of a mesh spanning at least minArea blocks, largest
+	// first, up to maxCount of them. Only greedy meshes have faces that
+	// large.
+	static void FindOccluders(const ChunkMesh &mesh, glm::ivec3 origin,
+				  uint32_t minArea, uint32_t maxCount,
+				  std::vector<OccluderQuad> &occluders);
+
+	static constexpr uint32_t kTileWidth = 16;
+	static constexpr uint32_t kTileHeight = 16;
+
+    private:
+	// Screen space setup of an occluder. Edge functions are positive on
+	// pixel centres whose whole pixel is inside, depth is a plane in
+	// pixel coordinates.
+	struct Occluder {
+		float edges[4][3];
+		float depth[3];
+		int minX, minY, maxX, maxY;
+	};
+
+	void RasterizeBand(uint32_t tileRow);
+
+	inline float &GetDepth(uint32_t x, uint32_t y)
+	{
+		return m_depth[y * m_width + x];
+	}
+
+    private:
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_tilesX = 0;
+	uint32_t m_tilesY = 0;
+
+	glm::mat4 m_viewProj;
+
+	std::vector<Occluder> m_occluders;
+
+	// Normalized device depth, 1 where nothing was drawn.
+	std::vector<float> m_depth;
+	// Farthest depth of each tile.
+	std::vector<float> m_tileDepth;
+};
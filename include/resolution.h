@@ -0,0 +1,138 @@
+#pragma once
+
+#include "logger.h"
+#include "upload.h"
+#include "webgpu.h"
+
+#include <cstdint>
+#include <vector>
+
+DECLARE_LOG_CATEGORY(Resolution);
+
+// Renders the scene into a target smaller than the surface when the GPU
+// falls behind, then upscales it to the surface with a filtered blit.
+//
+// GPU time is measured with timestamps written at the start of the first
+// scene pass and the end of the blit, read back asynchronously like the
+// occlusion queries. Their average drives the scale of the target in
+// steps, with a pause after every change so the average can settle at the
+// new size. Without the TimestampQuery feature the scale stays at 1.
+class DynamicResolution {
+    public:
+	DynamicResolution() = default;
+	~DynamicResolution() = default;
+
+	// The target has the given format, the format of the surface, so
+	// pipelines drawing into the surface can draw into it too. The target
+	// frame time is in milliseconds. The blit pipeline compiles in the
+	// background, see Wait.
+	void Create(wgpu::Device &device, const char *src,
+		    wgpu::TextureFormat format, uint32_t width,
+		    uint32_t height, float targetFrameTime);
+	void Release();
+
+	// Blocks until the blit pipeline started by Create is compiled.
+	void Wait(wgpu::Instance &instance);
+
+	// Size of the surface the target is upscaled to.
+	void SetOutputSize(uint32_t width, uint32_t height);
+
+	// Turning scaling off goes back to full resolution.
+	void SetEnabled(bool enabled);
+
+	// Applies the latest scale, returns true when the target was
+	// recreated with a new size and everything sized like it has to be
+	// too.
+	bool Update(wgpu::Device &device);
+
+	// Starts the timing of a frame, returns false when every readback
+	// buffer is still in flight and the frame is not timed.
+	bool Begin();
+
+	// Timestamp writes of the first scene pass, null when the frame is
+	// not timed.
+	const wgpu::PassTimestampWrites *GetTimestampWrites() const;
+
+	// Records the upscale of the target into the output view.
+	void Blit(wgpu::CommandEncoder &encoder,
+		  const wgpu::TextureView &output);
+
+	// Records the resolve and copy of the timestamps.
+	void Resolve(wgpu::CommandEncoder &encoder);
+
+	// Maps the timestamps once the commands of Resolve were submitted.
+	void Read();
+
+	inline wgpu::TextureView &GetView()
+	{
+		return m_view;
+	}
+
+	inline uint32_t GetWidth() const
+	{
+		return m_width;
+	}
+
+	inline uint32_t GetHeight() const
+	{
+		return m_height;
+	}
+
+	inline float GetScale() const
+	{
+		return m_scale;
+	}
+
+	inline bool IsEnabled() const
+	{
+		return m_enabled;
+	}
+
+	inline bool IsSupported() const
+	{
+		return m_querySet != nullptr;
+	}
+
+	static constexpr float kMinScale = 0.5f;
+	static constexpr float kScaleStep = 0.125f;
+
+    private:
+	void CreateTarget(wgpu::Device &device);
+	void AddSample(float frameTime);
+
+	static constexpr uint32_t kReadbackCount = 3;
+	// Timed frames to wait after a change before the next one.
+	static constexpr uint32_t kSettleFrames = 30;
+
+    private:
+	wgpu::TextureFormat m_format;
+
+	wgpu::RenderPipeline m_pipeline;
+	std::vector<wgpu::Future> m_futures;
+	wgpu::BindGroupLayout m_bindGroupLayout;
+	wgpu::PipelineLayout m_layout;
+	wgpu::Sampler m_sampler;
+
+	wgpu::Texture m_texture;
+	wgpu::TextureView m_view;
+	wgpu::BindGroup m_bindGroup;
+
+	wgpu::QuerySet m_querySet;
+	wgpu::Buffer m_resolveBuffer;
+	wgpu::PassTimestampWrites m_beginWrites;
+	wgpu::PassTimestampWrites m_endWrites;
+
+	ReadbackRing m_ring;
+
+	uint32_t m_outputWidth = 0;
+	uint32_t m_outputHeight = 0;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+
+	bool m_enabled = true;
+	float m_scale = 1.0f;
+	float m_targetFrameTime = 0.0f;
+	// Exponential average of the measured GPU time in milliseconds.
+	float m_frameTime = 0.0f;
+	uint32_t m_samples = 0;
+};
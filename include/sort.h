@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Sorts values by their upper 16 bits, leaving the lower 16 bits free to
+// carry an index. Two stable counting passes, one per key byte, through
+// scratch, which is resized as needed.
+void RadixSort16(std::vector<uint32_t> &values, std::vector<uint32_t> &scratch);
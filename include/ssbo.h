@@ -2,6 +2,28 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+
+// Per-chunk placement and mesh range, indexed by the chunk's slot. Mesh
+// vertices are chunk-local, so a chunk only needs its integer world origin.
+// mesh.x is the quad count and mesh.y the first vertex of the chunk in the
+// shared vertex buffer; a slot without a mesh has a quad count of 0.
+// faces holds the quad count of each face direction, two 16-bit counts per
+// component in Face order, low half first. A chunk has at most
+// CHUNK_SIZE^3 / 2 faces in one direction, so they always fit.
 struct SSBOData {
-	glm::mat4 model;
+	glm::ivec4 origin;
+	glm::uvec4 mesh;
+	glm::uvec4 faces;
+};
+
+// Argument record of DrawIndexedIndirect, written by the cull compute pass.
+struct DrawIndexedIndirectArgs {
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t firstInstance;
 };
+
+static_assert(sizeof(DrawIndexedIndirectArgs) == 5 * sizeof(uint32_t));
@@ -1,26 +1,114 @@
 #pragma once
 
+#include "upload.h"
 #include "webgpu.h"
 
+#include <cstdint>
+#include <vector>
+
+// 2D texture array of RGBA8 sRGB layers with a full mip chain, sampled
+// with trilinear filtering and repeating coordinates. Layers are either
+// uploaded at level 0 and the levels below generated on the GPU, or
+// uploaded with every level precomputed, see include/cooked.h.
 class Texture {
     public:
 	Texture() = default;
 	~Texture() = default;
 
-	void Create(wgpu::Device &device, void *data, int width, int height);
+	// The mip shader generates the levels below 0, see GenerateMips. It
+	// may be null when every level is uploaded with UploadLevel. Its
+	// pipeline compiles in the background, see Wait.
+	void Create(wgpu::Device &device, const char *mipSrc, uint32_t width,
+		    uint32_t height, uint32_t layerCount);
 	void Release();
 
+	// Blocks until the mip pipeline started by Create is compiled.
+	void Wait(wgpu::Instance &instance);
+
+	// Uploads level 0 of a layer, rows of RGBA8 texels tightly packed, and
+	// has the levels below generated.
+	void UploadLayer(Uploader &uploader, uint32_t layer, const void *data);
+
+	// Uploads a single level of a layer as is, returns the upload's
+	// ticket.
+	uint64_t UploadLevel(Uploader &uploader, uint32_t layer, uint32_t level,
+			     const void *data);
+
+	// Records the downsampling of the layers uploaded since the last call
+	// whose level 0 the uploader has staged, the others wait for a later
+	// call. The commands have to be submitted after the uploader's.
+	void GenerateMips(const Uploader &uploader,
+			  wgpu::CommandEncoder &encoder);
+
+	inline bool NeedsMips() const
+	{
+		return m_dirtyCount > 0;
+	}
+
 	inline wgpu::Texture &GetTexture()
 	{
 		return m_texture;
 	}
 
+	// View of every layer and level, as a 2D array.
 	inline wgpu::TextureView &GetView()
 	{
 		return m_view;
 	}
 
+	inline wgpu::Sampler &GetSampler()
+	{
+		return m_sampler;
+	}
+
+	inline uint32_t GetWidth() const
+	{
+		return m_width;
+	}
+
+	inline uint32_t GetHeight() const
+	{
+		return m_height;
+	}
+
+	inline uint32_t GetMipCount() const
+	{
+		return m_mipCount;
+	}
+
+	inline uint32_t GetLayerCount() const
+	{
+		return m_layerCount;
+	}
+
+	// Levels of a full mip chain for a layer of the given size.
+	static uint32_t CountMips(uint32_t width, uint32_t height);
+
+	static constexpr wgpu::TextureFormat kFormat =
+		wgpu::TextureFormat::RGBA8UnormSrgb;
+
+    private:
+	wgpu::TextureView CreateLevelView(uint32_t level, uint32_t layer);
+
     private:
+	wgpu::Device m_device;
+
 	wgpu::Texture m_texture;
 	wgpu::TextureView m_view;
+	wgpu::Sampler m_sampler;
+
+	// Renders one level from the one above, see mipmap.wgsl.
+	wgpu::RenderPipeline m_mipPipeline;
+	std::vector<wgpu::Future> m_futures;
+	wgpu::Sampler m_mipSampler;
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_layerCount = 0;
+	uint32_t m_mipCount = 0;
+
+	// Ticket of the level 0 upload of each layer without its mips yet,
+	// zero for the others.
+	std::vector<uint64_t> m_dirty;
+	uint32_t m_dirtyCount = 0;
 };
@@ -1,8 +1,19 @@
 #pragma once
 
+#include "frustum.h"
+
 #include <glm/glm.hpp>
 
 struct UniformData {
 	glm::mat4 proj;
 	glm::mat4 view;
+	// Planes of proj * view, used by the cull pass.
+	Frustum frustum;
+	// proj * view of the frame the depth pyramid was built from.
+	glm::mat4 hizViewProj;
+	// x: whether the occlusion test is enabled, y: pyramid mip count,
+	// zw: pyramid size.
+	glm::uvec4 hiz;
+	// xyz: camera position, for skipping faces pointing away from it.
+	glm::vec4 camera;
 };
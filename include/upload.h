@@ -0,0 +1,185 @@
+#pragma once
+
+#include "logger.h"
+#include "webgpu.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+DECLARE_LOG_CATEGORY(Upload);
+
+// Batches buffer and texture uploads through a ring of persistently
+// mapped staging pages. Data is copied into the mapped pages as it is
+// queued, and Submit() records all pending copies into one command
+// buffer, merging copies that are contiguous in both source and
+// destination. Pages are re-mapped asynchronously once the GPU is done
+// with them.
+//
+// At most the frame budget is staged per frame, later uploads are kept in
+// order and staged on following frames. A single upload larger than the
+// budget is still staged, alone, so nothing can stall forever. Every
+// upload returns a ticket, and since uploads are staged in order, callers
+// can hold back anything that depends on an upload until IsStaged.
+class Uploader {
+    public:
+	Uploader() = default;
+	~Uploader() = default;
+
+	void Create(wgpu::Device &device, uint64_t pageSize,
+		    uint64_t frameBudget);
+	void Release();
+
+	// Offset and size must be multiples of 4, as for Queue::WriteBuffer.
+	uint64_t Upload(const wgpu::Buffer &buffer, uint64_t offset,
+			const void *data, uint64_t size);
+
+	// Uploads a single layer of a texture. Rows are tightly packed in
+	// data, bytesPerRow apart.
+	uint64_t UploadTexture(const wgpu::TexelCopyTextureInfo &destination,
+			       const void *data, uint32_t bytesPerRow,
+			       const wgpu::Extent3D &size);
+
+	// Records and submits the copies staged this frame.
+	void Submit();
+
+	// Whether the upload and every one before it are staged. Staged
+	// copies are submitted by the next Submit, so they land before any
+	// commands submitted after it.
+	inline bool IsStaged(uint64_t ticket) const
+	{
+		return ticket <= m_stagedTicket;
+	}
+
+	inline uint64_t GetPendingBytes() const
+	{
+		return m_pendingBytes;
+	}
+
+    private:
+	struct Page {
+		wgpu::Buffer buffer;
+		uint64_t size = 0;
+		uint64_t used = 0;
+		uint8_t *mapped = nullptr;
+	};
+
+	struct BufferCopy {
+		Page *page;
+		uint64_t srcOffset;
+		wgpu::Buffer dst;
+		uint64_t dstOffset;
+		uint64_t size;
+	};
+
+	struct TextureCopy {
+		Page *page;
+		uint64_t srcOffset;
+		uint32_t bytesPerRow;
+		wgpu::TexelCopyTextureInfo dst;
+		wgpu::Extent3D size;
+	};
+
+	// An upload over budget, waiting in order for a later frame.
+	struct Deferred {
+		uint64_t ticket;
+		bool isTexture;
+		wgpu::Buffer buffer;
+		uint64_t offset;
+		wgpu::TexelCopyTextureInfo texture;
+		uint32_t bytesPerRow;
+		wgpu::Extent3D size;
+		std::vector<uint8_t> data;
+	};
+
+	static inline uint64_t Align(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool HasBudget(uint64_t size) const;
+
+	// Reserves size bytes of mapped staging memory.
+	Page *Allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+
+	void StageBuffer(const wgpu::Buffer &buffer, uint64_t offset,
+			 const void *data, uint64_t size);
+	void StageTexture(const wgpu::TexelCopyTextureInfo &destination,
+			  const void *data, uint32_t bytesPerRow,
+			  const wgpu::Extent3D &size);
+
+	void Recycle(Page *page);
+
+    private:
+	wgpu::Device m_device;
+
+	uint64_t m_pageSize = 0;
+	uint64_t m_frameBudget = 0;
+	uint64_t m_frameBytes = 0;
+	uint64_t m_pendingBytes = 0;
+
+	// Last ticket handed out, and the last one staged.
+	uint64_t m_ticket = 0;
+	uint64_t m_stagedTicket = 0;
+
+	std::vector<std::unique_ptr<Page> > m_pages;
+	std::vector<Page *> m_free;
+	std::vector<Page *> m_used;
+	Page *m_current = nullptr;
+
+	std::vector<BufferCopy> m_bufferCopies;
+	std::vector<TextureCopy> m_textureCopies;
+	std::deque<Deferred> m_deferred;
+};
+
+// Ring of buffers GPU results are copied into and mapped back from, so
+// results of a frame arrive a few frames later without stalling. A frame
+// picks a buffer with Begin, copies into GetBuffer() and calls Read once
+// the copy was submitted. Frames are skipped while every buffer is still
+// being read.
+class ReadbackRing {
+    public:
+	ReadbackRing() = default;
+	~ReadbackRing() = default;
+
+	void Create(wgpu::Device &device, uint32_t count, uint64_t size);
+	void Release();
+
+	// Picks a buffer for this frame, returns false when none is free.
+	bool Begin();
+
+	// Maps the first size bytes of the buffer picked by Begin and passes
+	// them to read, from a later ProcessEvents. A size of zero gives the
+	// buffer back unread.
+	void Read(uint64_t size, std::function<void(const void *data)> read);
+
+	// Whether Begin picked a buffer that Read was not called for yet.
+	inline bool IsActive() const
+	{
+		return m_current != nullptr;
+	}
+
+	// Index of the buffer picked by Begin, for state kept per buffer.
+	inline uint32_t GetIndex() const
+	{
+		return m_current->index;
+	}
+
+	inline wgpu::Buffer &GetBuffer()
+	{
+		return m_current->buffer;
+	}
+
+    private:
+	struct Entry {
+		wgpu::Buffer buffer;
+		uint32_t index;
+		bool pending = false;
+	};
+
+    private:
+	std::vector<std::unique_ptr<Entry> > m_entries;
+	Entry *m_current = nullptr;
+};
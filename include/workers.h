@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running parallel loops and background
+// tasks. Builds without threads, such as Emscripten without pthreads, get
+// no workers and run every loop on the calling thread, and every task in
+// Wait.
+class WorkerPool {
+    public:
+	WorkerPool() = default;
+	~WorkerPool() = default;
+
+	void Create(uint32_t threadCount);
+	void Release();
+
+	// Calls job(i) for every i below count, spread over the workers and
+	// the calling thread, and returns once all calls have finished.
+	void Run(uint32_t count, const std::function<void(uint32_t)> &job);
+
+	// Queues a task for the next free worker. Workers busy with a task
+	// join loops once they are done with it.
+	void Start(std::function<void()> task);
+
+	// Returns once every started task has finished, running the ones no
+	// worker has picked up yet on the calling thread.
+	void Wait();
+
+	inline uint32_t GetThreadCount() const
+	{
+		return m_threads.size();
+	}
+
+    private:
+	void WorkerMain();
+	void Work();
+
+	// Runs the next queued task with the lock held on entry and exit.
+	void RunTask(std::unique_lock<std::mutex> &lock);
+
+    private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	const std::function<void(uint32_t)> *m_job = nullptr;
+	std::atomic<uint32_t> m_next = 0;
+	uint32_t m_count = 0;
+	// Workers that have not finished the current loop.
+	uint32_t m_busy = 0;
+	// Bumped for every loop, so workers wake up once per loop.
+	uint64_t m_generation = 0;
+	bool m_quit = false;
+
+	std::deque<std::function<void()> > m_tasks;
+	// Tasks started and not finished yet.
+	uint32_t m_pendingTasks = 0;
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "logger.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define CHUNK_SIZE 32
+
+// Chunk columns are stored as 32-bit occupancy masks.
+static_assert(CHUNK_SIZE <= 32);
+
+DECLARE_LOG_CATEGORY(World);
+
+using Block = uint8_t;
+
+#define BLOCK_AIR 0
+#define BLOCK_COBBLESTONE 1
+
+class Chunk {
+    public:
+	Chunk(glm::ivec3 coord);
+	~Chunk() = default;
+
+	static inline int GetBlockIdx(int x, int y, int z)
+	{
+		return z + CHUNK_SIZE * (y + CHUNK_SIZE * x);
+	}
+
+	inline Block GetBlock(int x, int y, int z) const
+	{
+		return m_blocks[GetBlockIdx(x, y, z)];
+	}
+
+	void SetBlock(int x, int y, int z, Block block);
+
+	// Occupancy of the column at (x, z), one bit per y.
+	inline uint32_t GetColumn(int x, int z) const
+	{
+		return m_columns[x * CHUNK_SIZE + z];
+	}
+
+	inline glm::ivec3 GetCoord() const
+	{
+		return m_coord;
+	}
+
+	inline glm::ivec3 GetOrigin() const
+	{
+		return m_coord * CHUNK_SIZE;
+	}
+
+	inline bool IsEmpty() const
+	{
+		return m_solidCount == 0;
+	}
+
+	// Whether every solid block in the chunk is of the same type. This is
+	// conservative, a chunk that once held several types stays mixed
+	// until it is emptied.
+	inline bool IsUniform() const
+	{
+		return !m_mixed;
+	}
+
+	inline Block GetUniformType() const
+	{
+		return m_type;
+	}
+
+	inline bool IsDirty() const
+	{
+		return m_dirty;
+	}
+
+	inline void SetDirty(bool dirty)
+	{
+		m_dirty = dirty;
+	}
+
+    private:
+	glm::ivec3 m_coord;
+	uint32_t m_solidCount = 0;
+	bool m_dirty = true;
+
+	Block m_type = BLOCK_AIR;
+	bool m_mixed = false;
+
+	Block m_blocks[CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE] = {};
+	uint32_t m_columns[CHUNK_SIZE * CHUNK_SIZE] = {};
+};
+
+class World {
+    public:
+	World() = default;
+	~World() = default;
+
+	// Packs a chunk coordinate into a 64-bit key, 21 bits per axis.
+	static uint64_t GetChunkKey(glm::ivec3 coord);
+
+	static glm::ivec3 GetChunkCoord(glm::ivec3 pos);
+	static glm::ivec3 GetLocalPos(glm::ivec3 pos);
+
+	// Loads chunks within the render distance of the camera and unloads
+	// the ones that have left it. At most m_loadBudget chunks are
+	// generated per call, nearest first.
+	void Update(glm::vec3 cameraPos);
+	void Release();
+
+	Chunk *GetChunk(glm::ivec3 coord) const;
+
+	Block GetBlock(glm::ivec3 pos) const;
+	bool SetBlock(glm::ivec3 pos, Block block);
+
+	inline bool IsLoaded(glm::ivec3 pos) const
+	{
+		return GetChunk(GetChunkCoord(pos)) != nullptr;
+	}
+
+	inline const std::unordered_map<uint64_t, std::unique_ptr<Chunk> > &
+	GetChunks() const
+	{
+		return m_chunks;
+	}
+
+	inline void SetRenderDistance(int horizontal, int vertical)
+	{
+		m_renderDistance = horizontal;
+		m_verticalDistance = vertical;
+		m_centerValid = false;
+	}
+
+	// Upper bound on the number of chunks that can be loaded at once,
+	// including the one chunk ring kept around before unloading.
+	inline uint32_t GetMaxLoadedChunks() const
+	{
+		uint32_t width = 2 * (m_renderDistance + 1) + 1;
+		uint32_t height = 2 * (m_verticalDistance + 1) + 1;
+		return width * width * height;
+	}
+
+    private:
+	void Generate(Chunk &chunk);
+	void MarkDirty(glm::ivec3 coord);
+
+    private:
+	std::unordered_map<uint64_t, std::unique_ptr<Chunk> > m_chunks;
+	std::vector<glm::ivec3> m_pending;
+
+	glm::ivec3 m_center = { 0, 0, 0 };
+	bool m_centerValid = false;
+
+	int m_renderDistance = 4;
+	int m_verticalDistance = 2;
+	int m_loadBudget = 8;
+};
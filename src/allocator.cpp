@@ -0,0 +1,66 @@
+#include "allocator.h"
+
+#include <iterator>
+
+void RangeAllocator::Create(uint32_t capacity)
+{
+	Release();
+
+	m_capacity = capacity;
+	m_free[0] = capacity;
+}
+
+void RangeAllocator::Release()
+{
+	m_free.clear();
+	m_capacity = 0;
+	m_used = 0;
+}
+
+bool RangeAllocator::Allocate(uint32_t size, uint32_t &offset)
+{
+	for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+		if (it->second < size) {
+			continue;
+		}
+
+		offset = it->first;
+		uint32_t remaining = it->second - size;
+
+		m_free.erase(it);
+		if (remaining > 0) {
+			m_free[offset + size] = remaining;
+		}
+
+		m_used += size;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	m_used -= size;
+
+	auto next = m_free.lower_bound(offset);
+
+	if (next != m_free.end() && offset + size == next->first) {
+		size += next->second;
+		next = m_free.erase(next);
+	}
+
+	if (next != m_free.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+
+	m_free[offset] = size;
+}
@@ -4,6 +4,12 @@
 
 #include <glm/glm.hpp>
 
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
 DEFINE_LOG_CATEGORY(Application);
 DEFINE_LOG_CATEGORY(WebGPU);
 
@@ -13,18 +19,52 @@ static Application *g_instance = nullptr;
 
 void Application::Create()
 {
+	float startTime = glfwGetTime();
+
 	InitWindow();
 	InitInstance();
-	InitAdapter();
-	InitDevice();
+
+	// The main thread takes part in every loop.
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	m_workers.Create(threadCount > 1 ? threadCount - 1 : 0);
+	LOG_INFO(Application, "Worker threads: {}", m_workers.GetThreadCount());
+
+	// The adapter and device come up while the tasks started by Prepare
+	// run, and Init starts the pipelines before it waits for the tasks.
+	wgpu::Future adapterFuture = InitAdapter();
+
+	Prepare();
+
+	m_instance.WaitAny(adapterFuture, UINT64_MAX);
+	m_instance.WaitAny(m_deviceFuture, UINT64_MAX);
+
 	InitSurface();
 
+	m_uploader.Create(m_device, 4 << 20, 8 << 20);
+
 	Init();
+	m_workers.Wait();
+
+	LOG_INFO(Application, "Started in {:.0f} ms",
+		 (glfwGetTime() - startTime) * 1000.0f);
+	m_cache.LogStats();
 }
 
 void Application::Loop(float deltaTime)
 {
+	// Minimized windows have no size, the surface keeps the last one.
+	int width = m_window.GetWidth();
+	int height = m_window.GetHeight();
+
+	if (width > 0 && height > 0 &&
+	    (uint32_t(width) != m_surfaceWidth ||
+	     uint32_t(height) != m_surfaceHeight)) {
+		ConfigureSurface(width, height);
+		Resize(width, height);
+	}
+
 	Update(deltaTime);
+	m_uploader.Submit();
 	Render();
 
 	m_window.ResetInput();
@@ -34,6 +74,9 @@ void Application::Release()
 {
 	Destroy();
 
+	m_workers.Release();
+	m_uploader.Release();
+
 	if (m_surface) {
 		m_surface.Unconfigure();
 		m_surface = nullptr;
@@ -51,6 +94,7 @@ void Application::Release()
 		m_instance = nullptr;
 	}
 
+	m_cache.Release();
 	m_window.Release();
 }
 
@@ -64,6 +108,7 @@ void Application::EmscriptenLoop()
 	lastTime = time;
 
 	g_instance->Loop(deltaTime);
+	g_instance->m_instance.ProcessEvents();
 #endif
 }
 
@@ -123,10 +168,12 @@ void Application::InitInstance()
 	m_instance = wgpu::CreateInstance(&instanceDesc);
 }
 
-void Application::InitAdapter()
+// The callbacks may run on any thread as soon as their request completes,
+// the adapter's requests the device right away.
+wgpu::Future Application::InitAdapter()
 {
-	wgpu::Future future = m_instance.RequestAdapter(
-		nullptr, wgpu::CallbackMode::WaitAnyOnly,
+	return m_instance.RequestAdapter(
+		nullptr, wgpu::CallbackMode::AllowSpontaneous,
 		[this](wgpu::RequestAdapterStatus status, wgpu::Adapter a,
 		       wgpu::StringView message) {
 			LOG_CRITICAL_IF(
@@ -135,9 +182,8 @@ void Application::InitAdapter()
 				"RequestAdapter: {}", message);
 
 			m_adapter = std::move(a);
+			InitDevice();
 		});
-
-	m_instance.WaitAny(future, UINT64_MAX);
 }
 
 wgpu::Limits Application::GetRequiredLimits()
@@ -147,25 +193,27 @@ wgpu::Limits Application::GetRequiredLimits()
 
 	wgpu::Limits requiredLimits = {};
 
-	requiredLimits.maxVertexAttributes = 2;
+	requiredLimits.maxVertexAttributes = 1;
 	requiredLimits.maxVertexBuffers = 1;
-	requiredLimits.maxBufferSize = 6 * 6 * 6 * sizeof(float);
-	requiredLimits.maxVertexBufferArrayStride = 6 * sizeof(float);
+	requiredLimits.maxVertexBufferArrayStride = 2 * sizeof(uint32_t);
 	requiredLimits.maxInterStageShaderVariables = 2;
 	requiredLimits.maxBindGroups = 1;
 
 	requiredLimits.maxSampledTexturesPerShaderStage = 1;
 
 	requiredLimits.maxUniformBuffersPerShaderStage = 1;
-	requiredLimits.maxUniformBufferBindingSize = 64 * sizeof(float);
+	requiredLimits.maxUniformBufferBindingSize = 84 * sizeof(float);
 
-	requiredLimits.maxDynamicStorageBuffersPerPipelineLayout = 1;
-	requiredLimits.maxStorageBuffersPerShaderStage = 1;
-	requiredLimits.maxStorageBufferBindingSize = 256 * 32 * 32 * 32;
+	requiredLimits.maxDynamicStorageBuffersPerPipelineLayout = 0;
+	requiredLimits.maxStorageBuffersPerShaderStage = 5;
 
-	requiredLimits.maxTextureDimension1D = m_window.GetWidth();
-	requiredLimits.maxTextureDimension2D = m_window.GetHeight();
-	requiredLimits.maxTextureArrayLayers = 1;
+	// Runs in the adapter callback, off the thread GLFW has to be used on.
+	requiredLimits.maxTextureDimension1D = Config::Get().GetWidth();
+	// The window may grow past its initial size.
+	requiredLimits.maxTextureDimension2D =
+		supportedLimits.maxTextureDimension2D;
+	// One block texture layer per block type.
+	requiredLimits.maxTextureArrayLayers = 256;
 
 	requiredLimits.minUniformBufferOffsetAlignment =
 		supportedLimits.minUniformBufferOffsetAlignment;
@@ -175,13 +223,33 @@ wgpu::Limits Application::GetRequiredLimits()
 
 	m_minSSBOStride = supportedLimits.minStorageBufferOffsetAlignment;
 
+	RequireLimits(requiredLimits);
+
 	return requiredLimits;
 }
 
 void Application::InitDevice()
 {
 	wgpu::Limits limits = GetRequiredLimits();
+
+	// Optional features, GPU-driven drawing is only offered with them.
+	static const wgpu::FeatureName kOptionalFeatures[] = {
+		wgpu::FeatureName::IndirectFirstInstance,
+		wgpu::FeatureName::MultiDrawIndirect,
+		// Dynamic resolution measures GPU time with timestamps.
+		wgpu::FeatureName::TimestampQuery,
+	};
+
+	std::vector<wgpu::FeatureName> features;
+	for (wgpu::FeatureName feature : kOptionalFeatures) {
+		if (m_adapter.HasFeature(feature)) {
+			features.push_back(feature);
+		}
+	}
+
 	wgpu::DeviceDescriptor deviceDesc({
+		.requiredFeatureCount = features.size(),
+		.requiredFeatures = features.data(),
 		.requiredLimits = &limits,
 	});
 
@@ -192,8 +260,32 @@ void Application::InitDevice()
 			  message);
 	});
 
-	wgpu::Future future = m_adapter.RequestDevice(
-		&deviceDesc, wgpu::CallbackMode::WaitAnyOnly,
+#if !defined(__EMSCRIPTEN__)
+	// Compiled shaders and pipelines persist across runs. Dawn prefixes
+	// every key with the isolation key, so blobs of another GPU or driver
+	// are never loaded.
+	wgpu::AdapterInfo info;
+	m_adapter.GetInfo(&info);
+
+	std::string isolationKey =
+		std::to_string(uint32_t(info.backendType)) + ":" +
+		std::to_string(info.vendorID) + ":" +
+		std::to_string(info.deviceID) + ":" +
+		std::string(std::string_view(info.description));
+
+	wgpu::DawnCacheDeviceDescriptor cacheDesc;
+
+	if (m_cache.Create("./cache")) {
+		cacheDesc.isolationKey = isolationKey.c_str();
+		cacheDesc.loadDataFunction = BlobCache::LoadData;
+		cacheDesc.storeDataFunction = BlobCache::StoreData;
+		cacheDesc.functionUserdata = &m_cache;
+		deviceDesc.nextInChain = &cacheDesc;
+	}
+#endif
+
+	m_deviceFuture = m_adapter.RequestDevice(
+		&deviceDesc, wgpu::CallbackMode::AllowSpontaneous,
 		[this](wgpu::RequestDeviceStatus status, wgpu::Device d,
 		       wgpu::StringView message) {
 			LOG_CRITICAL_IF(
@@ -203,8 +295,6 @@ void Application::InitDevice()
 
 			m_device = std::move(d);
 		});
-
-	m_instance.WaitAny(future, UINT64_MAX);
 }
 
 void Application::InitSurface()
@@ -216,29 +306,42 @@ void Application::InitSurface()
 	m_surface.GetCapabilities(m_adapter, &capabilities);
 	m_format = capabilities.formats[0];
 
+	ConfigureSurface(m_window.GetWidth(), m_window.GetHeight());
+}
+
+void Application::ConfigureSurface(uint32_t width, uint32_t height)
+{
 	wgpu::SurfaceConfiguration config = {
 		.device = m_device,
 		.format = m_format,
-		.width = static_cast<uint32_t>(m_window.GetWidth()),
-		.height = static_cast<uint32_t>(m_window.GetHeight()),
+		.width = width,
+		.height = height,
 	};
 
 	m_surface.Configure(&config);
+
+	m_surfaceWidth = width;
+	m_surfaceHeight = height;
+
+	LOG_DEBUG(Application, "Surface size: {}x{}", width, height);
 }
 
 wgpu::Buffer Application::CreateBuffer(void *data, size_t size,
 				       wgpu::BufferUsage usage)
 {
+	// Initial contents are written straight into the mapped buffer, which
+	// avoids a staging copy. Mapped buffers need a size aligned to 4.
 	wgpu::BufferDescriptor desc = {
 		.usage = wgpu::BufferUsage::CopyDst | usage,
-		.size = size,
-		.mappedAtCreation = false,
+		.size = (size + 3) & ~size_t(3),
+		.mappedAtCreation = data != nullptr,
 	};
 
 	wgpu::Buffer buffer = m_device.CreateBuffer(&desc);
 
 	if (data != nullptr) {
-		m_device.GetQueue().WriteBuffer(buffer, 0, data, size);
+		std::memcpy(buffer.GetMappedRange(), data, size);
+		buffer.Unmap();
 	}
 
 	return buffer;
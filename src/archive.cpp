@@ -0,0 +1,203 @@
+#include "archive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__EMSCRIPTEN__)
+#include <fstream>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY(Assets);
+
+AssetArchive::~AssetArchive()
+{
+	Close();
+}
+
+bool AssetArchive::Open(const char *path)
+{
+	Close();
+
+#if defined(__EMSCRIPTEN__)
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		LOG_ERROR(Assets, "Failed to open {}!", path);
+		return false;
+	}
+
+	m_buffer.assign(std::istreambuf_iterator<char>(file),
+			std::istreambuf_iterator<char>());
+
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#elif defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+				  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		LOG_ERROR(Assets, "Failed to open {}!", path);
+		return false;
+	}
+
+	m_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		LOG_ERROR(Assets, "Failed to get the size of {}!", path);
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+				       nullptr);
+	if (!m_mapping) {
+		LOG_ERROR(Assets, "Failed to map {}!", path);
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t *>(
+		MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		LOG_ERROR(Assets, "Failed to open {}!", path);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		LOG_ERROR(Assets, "Failed to get the size of {}!", path);
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps the file alive, the descriptor is not needed.
+	void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data != MAP_FAILED) {
+		m_data = static_cast<const uint8_t *>(data);
+		m_size = info.st_size;
+	}
+#endif
+
+	if (!m_data) {
+		LOG_ERROR(Assets, "Failed to map {}!", path);
+		Close();
+		return false;
+	}
+
+	if (!Validate()) {
+		LOG_ERROR(Assets, "{} is not a valid asset archive!", path);
+		Close();
+		return false;
+	}
+
+	LOG_INFO(Assets, "Opened {} with {} assets, {} bytes", path,
+		 m_entryCount, m_size);
+
+	return true;
+}
+
+void AssetArchive::Close()
+{
+#if defined(__EMSCRIPTEN__)
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+#elif defined(_WIN32)
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file) {
+		CloseHandle(m_file);
+		m_file = nullptr;
+	}
+#else
+	if (m_data) {
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_entries = nullptr;
+	m_entryCount = 0;
+}
+
+std::span<const uint8_t> AssetArchive::Find(std::string_view name) const
+{
+	const ArchiveEntry *end = m_entries + m_entryCount;
+
+	// Entries are sorted by name, see tools/packer.cpp.
+	const ArchiveEntry *entry = std::lower_bound(
+		m_entries, end, name,
+		[](const ArchiveEntry &entry, std::string_view name) {
+			return std::string_view(entry.name) < name;
+		});
+
+	if (entry == end || std::string_view(entry->name) != name) {
+		return {};
+	}
+
+	return { m_data + entry->offset, size_t(entry->size) };
+}
+
+const char *AssetArchive::FindText(std::string_view name) const
+{
+	std::span<const uint8_t> data = Find(name);
+	if (data.data() == nullptr) {
+		return nullptr;
+	}
+
+	return reinterpret_cast<const char *>(data.data());
+}
+
+bool AssetArchive::Validate()
+{
+	if (m_size < sizeof(ArchiveHeader)) {
+		return false;
+	}
+
+	const auto &header = *reinterpret_cast<const ArchiveHeader *>(m_data);
+
+	if (header.magic != kArchiveMagic || header.version != kArchiveVersion ||
+	    header.entryCount >
+		    (m_size - sizeof(ArchiveHeader)) / sizeof(ArchiveEntry)) {
+		return false;
+	}
+
+	const ArchiveEntry *entries = reinterpret_cast<const ArchiveEntry *>(
+		m_data + sizeof(ArchiveHeader));
+
+	// Names must be terminated and contents, with their terminating zero,
+	// inside the file.
+	for (uint32_t i = 0; i < header.entryCount; i++) {
+		const ArchiveEntry &entry = entries[i];
+
+		if (std::memchr(entry.name, 0, sizeof(entry.name)) == nullptr ||
+		    entry.offset > m_size || entry.size >= m_size - entry.offset ||
+		    m_data[entry.offset + entry.size] != 0) {
+			return false;
+		}
+	}
+
+	m_entries = entries;
+	m_entryCount = header.entryCount;
+	return true;
+}
@@ -0,0 +1,172 @@
+#include "bounds.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOUNDS_SSE
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+void ChunkBounds::Create(uint32_t capacity)
+{
+	Release();
+
+	m_capacity = (capacity + kLanes - 1) / kLanes * kLanes;
+
+	for (auto *array : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY,
+			     &m_maxZ }) {
+		array->assign(m_capacity, 0.0f);
+	}
+
+	m_visible.assign(m_capacity, 0);
+}
+
+void ChunkBounds::Release()
+{
+	for (auto *array : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY,
+			     &m_maxZ }) {
+		array->clear();
+	}
+
+	m_visible.clear();
+	m_capacity = 0;
+}
+
+void ChunkBounds::Set(uint32_t slot, glm::vec3 min, glm::vec3 max)
+{
+	m_minX[slot] = min.x;
+	m_minY[slot] = min.y;
+	m_minZ[slot] = min.z;
+	m_maxX[slot] = max.x;
+	m_maxY[slot] = max.y;
+	m_maxZ[slot] = max.z;
+}
+
+void ChunkBounds::Cull(const Frustum &frustum)
+{
+	// For each plane the corner furthest along its normal is the same
+	// choice of min or max for every box, so it picks whole arrays.
+	const float *xs[PLANE_COUNT], *ys[PLANE_COUNT], *zs[PLANE_COUNT];
+
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		const glm::vec4 &plane = frustum.planes[p];
+		xs[p] = plane.x >= 0.0f ? m_maxX.data() : m_minX.data();
+		ys[p] = plane.y >= 0.0f ? m_maxY.data() : m_minY.data();
+		zs[p] = plane.z >= 0.0f ? m_maxZ.data() : m_minZ.data();
+	}
+
+#if defined(__AVX__)
+	__m256 nx[PLANE_COUNT], ny[PLANE_COUNT];
+	__m256 nz[PLANE_COUNT], nw[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+		ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+		nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+		nw[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	for (uint32_t i = 0; i < m_capacity; i += 8) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			__m256 x = _mm256_loadu_ps(xs[p] + i);
+			__m256 y = _mm256_loadu_ps(ys[p] + i);
+			__m256 z = _mm256_loadu_ps(zs[p] + i);
+
+			__m256 d = _mm256_mul_ps(nx[p], x);
+			d = _mm256_add_ps(d, nw[p]);
+			d = _mm256_add_ps(d, _mm256_mul_ps(ny[p], y));
+			d = _mm256_add_ps(d, _mm256_mul_ps(nz[p], z));
+
+			__m256 ge = _mm256_cmp_ps(d, _mm256_setzero_ps(),
+						  _CMP_GE_OQ);
+			inside = _mm256_and_ps(inside, ge);
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; lane++) {
+			m_visible[i + lane] = (mask >> lane) & 1;
+		}
+	}
+#elif defined(BOUNDS_SSE)
+	__m128 nx[PLANE_COUNT], ny[PLANE_COUNT];
+	__m128 nz[PLANE_COUNT], nw[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		nx[p] = _mm_set1_ps(frustum.planes[p].x);
+		ny[p] = _mm_set1_ps(frustum.planes[p].y);
+		nz[p] = _mm_set1_ps(frustum.planes[p].z);
+		nw[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	for (uint32_t i = 0; i < m_capacity; i += 4) {
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			__m128 x = _mm_loadu_ps(xs[p] + i);
+			__m128 y = _mm_loadu_ps(ys[p] + i);
+			__m128 z = _mm_loadu_ps(zs[p] + i);
+
+			__m128 d = _mm_add_ps(nw[p], _mm_mul_ps(nx[p], x));
+			d = _mm_add_ps(d, _mm_mul_ps(ny[p], y));
+			d = _mm_add_ps(d, _mm_mul_ps(nz[p], z));
+
+			__m128 ge = _mm_cmpge_ps(d, _mm_setzero_ps());
+			inside = _mm_and_ps(inside, ge);
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++) {
+			m_visible[i + lane] = (mask >> lane) & 1;
+		}
+	}
+#elif defined(__wasm_simd128__)
+	v128_t nx[PLANE_COUNT], ny[PLANE_COUNT];
+	v128_t nz[PLANE_COUNT], nw[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		nx[p] = wasm_f32x4_splat(frustum.planes[p].x);
+		ny[p] = wasm_f32x4_splat(frustum.planes[p].y);
+		nz[p] = wasm_f32x4_splat(frustum.planes[p].z);
+		nw[p] = wasm_f32x4_splat(frustum.planes[p].w);
+	}
+
+	for (uint32_t i = 0; i < m_capacity; i += 4) {
+		v128_t inside = wasm_i32x4_splat(-1);
+
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			v128_t x = wasm_v128_load(xs[p] + i);
+			v128_t y = wasm_v128_load(ys[p] + i);
+			v128_t z = wasm_v128_load(zs[p] + i);
+
+			v128_t d = wasm_f32x4_mul(nx[p], x);
+			d = wasm_f32x4_add(d, nw[p]);
+			d = wasm_f32x4_add(d, wasm_f32x4_mul(ny[p], y));
+			d = wasm_f32x4_add(d, wasm_f32x4_mul(nz[p], z));
+
+			v128_t ge = wasm_f32x4_ge(d, wasm_f32x4_splat(0.0f));
+			inside = wasm_v128_and(inside, ge);
+		}
+
+		uint32_t mask = wasm_i32x4_bitmask(inside);
+		for (int lane = 0; lane < 4; lane++) {
+			m_visible[i + lane] = (mask >> lane) & 1;
+		}
+	}
+#else
+	for (uint32_t i = 0; i < m_capacity; i++) {
+		bool inside = true;
+
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			const glm::vec4 &plane = frustum.planes[p];
+
+			float d = plane.x * xs[p][i] + plane.y * ys[p][i] +
+				  plane.z * zs[p][i] + plane.w;
+			inside &= d >= 0.0f;
+		}
+
+		m_visible[i] = inside;
+	}
+#endif
+}
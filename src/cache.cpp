@@ -0,0 +1,193 @@
+#include "cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+DEFINE_LOG_CATEGORY(Cache);
+
+bool BlobCache::Create(const char *path)
+{
+	Release();
+
+	m_path = std::filesystem::path(path) /
+		 ("v" + std::to_string(kCacheVersion));
+
+	std::error_code error;
+	std::filesystem::create_directories(m_path, error);
+	if (error) {
+		LOG_ERROR(Cache, "Failed to create {}: {}", m_path.string(),
+			  error.message());
+		return false;
+	}
+
+	m_enabled = true;
+	LOG_INFO(Cache, "Caching compiled shaders in {}", m_path.string());
+	return true;
+}
+
+void BlobCache::Release()
+{
+	m_enabled = false;
+	m_path.clear();
+
+	m_hits = 0;
+	m_misses = 0;
+	m_stores = 0;
+	m_loadedBytes = 0;
+	m_storedBytes = 0;
+}
+
+size_t BlobCache::LoadData(const void *key, size_t keySize, void *value,
+			   size_t valueSize, void *userdata)
+{
+	return static_cast<BlobCache *>(userdata)->Load(key, keySize, value,
+							valueSize);
+}
+
+void BlobCache::StoreData(const void *key, size_t keySize, const void *value,
+			  size_t valueSize, void *userdata)
+{
+	static_cast<BlobCache *>(userdata)->Store(key, keySize, value,
+						  valueSize);
+}
+
+void BlobCache::LogStats() const
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	LOG_INFO(Cache, "{} hits, {} misses, {} bytes loaded, {} stores, "
+			"{} bytes stored",
+		 m_hits.load(), m_misses.load(), m_loadedBytes.load(),
+		 m_stores.load(), m_storedBytes.load());
+}
+
+size_t BlobCache::Load(const void *key, size_t keySize, void *value,
+		       size_t valueSize)
+{
+	if (!m_enabled) {
+		return 0;
+	}
+
+	std::ifstream file(GetPath(key, keySize), std::ios::binary);
+
+	// Files of other keys with the same hash count as missing.
+	uint64_t storedKeySize = 0;
+	std::vector<char> storedKey;
+
+	if (file) {
+		file.read(reinterpret_cast<char *>(&storedKeySize),
+			  sizeof(storedKeySize));
+	}
+
+	if (file && storedKeySize == keySize) {
+		storedKey.resize(keySize);
+		file.read(storedKey.data(), keySize);
+	}
+
+	if (!file || storedKeySize != keySize ||
+	    std::memcmp(storedKey.data(), key, keySize) != 0) {
+		// Dawn only loads the value of blobs whose size it got.
+		if (!value) {
+			m_misses++;
+		}
+
+		return 0;
+	}
+
+	std::streampos start = file.tellg();
+	file.seekg(0, std::ios::end);
+	size_t size = size_t(file.tellg() - start);
+
+	if (!value) {
+		return size;
+	}
+
+	if (valueSize != size) {
+		m_misses++;
+		return 0;
+	}
+
+	file.seekg(start);
+	file.read(static_cast<char *>(value), size);
+	if (!file) {
+		m_misses++;
+		return 0;
+	}
+
+	m_hits++;
+	m_loadedBytes += size;
+	return size;
+}
+
+void BlobCache::Store(const void *key, size_t keySize, const void *value,
+		      size_t valueSize)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	// Written next to the blob and renamed over it, so loads on other
+	// threads or later runs never see a partial file.
+	std::filesystem::path path = GetPath(key, keySize);
+	std::filesystem::path temporary = path;
+	temporary += "." +
+		     std::to_string(std::hash<std::thread::id>()(
+			     std::this_thread::get_id())) +
+		     ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary);
+
+		uint64_t size = keySize;
+		file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+		file.write(static_cast<const char *>(key), keySize);
+		file.write(static_cast<const char *>(value), valueSize);
+
+		if (!file) {
+			LOG_WARN(Cache, "Failed to write {}!", temporary.string());
+			file.close();
+
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		LOG_WARN(Cache, "Failed to store {}: {}", path.string(),
+			 error.message());
+		std::filesystem::remove(temporary, error);
+		return;
+	}
+
+	m_stores++;
+	m_storedBytes += valueSize;
+}
+
+// FNV-1a of the key, collisions are told apart by the key in the file.
+std::filesystem::path BlobCache::GetPath(const void *key, size_t keySize) const
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(key);
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < keySize; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+
+	char name[17];
+	for (int i = 0; i < 16; i++) {
+		name[i] = "0123456789abcdef"[(hash >> (60 - 4 * i)) & 0xf];
+	}
+	name[16] = 0;
+
+	return m_path / name;
+}
@@ -0,0 +1,51 @@
+#include "frustum.h"
+
+Frustum Frustum::FromMatrix(const glm::mat4 &viewProj)
+{
+	// glm matrices are column-major, rows are gathered across columns.
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i],
+				    viewProj[2][i], viewProj[3][i]);
+	}
+
+	Frustum frustum;
+	frustum.planes[PLANE_LEFT] = rows[3] + rows[0];
+	frustum.planes[PLANE_RIGHT] = rows[3] - rows[0];
+	frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+	frustum.planes[PLANE_TOP] = rows[3] - rows[1];
+	frustum.planes[PLANE_NEAR] = rows[3] + rows[2];
+	frustum.planes[PLANE_FAR] = rows[3] - rows[2];
+
+	for (glm::vec4 &plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+Frustum Frustum::Infinite()
+{
+	Frustum frustum;
+	for (glm::vec4 &plane : frustum.planes) {
+		plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	return frustum;
+}
+
+bool Frustum::IntersectsBox(glm::vec3 min, glm::vec3 max) const
+{
+	for (const glm::vec4 &plane : planes) {
+		// The corner furthest along the plane normal.
+		glm::vec3 corner = glm::vec3(plane.x >= 0.0f ? max.x : min.x,
+					     plane.y >= 0.0f ? max.y : min.y,
+					     plane.z >= 0.0f ? max.z : min.z);
+
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
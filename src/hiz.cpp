@@ -0,0 +1,165 @@
+#include "hiz.h"
+
+#include <algorithm>
+
+void DepthPyramid::Create(wgpu::Device &device, const char *src,
+			  const wgpu::TextureView &depthView, uint32_t width,
+			  uint32_t height)
+{
+	Release();
+
+	// Both read one level and write the next, see hiz.wgsl. Level 0 is
+	// copied from the depth buffer.
+	std::vector<wgpu::BindGroupLayoutEntry> entries = {
+    wgpu::BindGroupLayoutEntry {
+      .binding = 0,
+      .visibility = wgpu::ShaderStage::Compute,
+      .texture = {
+        .sampleType = wgpu::TextureSampleType::Depth,
+        .viewDimension = wgpu::TextureViewDimension::e2D,
+      },
+    },
+    wgpu::BindGroupLayoutEntry {
+      .binding = 1,
+      .visibility = wgpu::ShaderStage::Compute,
+      .storageTexture = {
+        .access = wgpu::StorageTextureAccess::WriteOnly,
+        .format = wgpu::TextureFormat::R32Float,
+        .viewDimension = wgpu::TextureViewDimension::e2D,
+      },
+    }
+  };
+
+	m_copyPipeline.Create(device, src, "cs_copy", entries);
+
+	entries[0].texture.sampleType = wgpu::TextureSampleType::UnfilterableFloat;
+	m_downsamplePipeline.Create(device, src, "cs_downsample", entries);
+
+	Resize(device, depthView, width, height);
+}
+
+void DepthPyramid::Wait(wgpu::Instance &instance)
+{
+	m_copyPipeline.Wait(instance);
+	m_downsamplePipeline.Wait(instance);
+}
+
+void DepthPyramid::Resize(wgpu::Device &device,
+			  const wgpu::TextureView &depthView, uint32_t width,
+			  uint32_t height)
+{
+	m_bindGroups.clear();
+
+	m_width = width;
+	m_height = height;
+
+	m_mipCount = 1;
+	while ((std::max(width, height) >> m_mipCount) > 0) {
+		m_mipCount++;
+	}
+
+	wgpu::TextureDescriptor textureDesc = {
+    .usage = wgpu::TextureUsage::StorageBinding |
+             wgpu::TextureUsage::TextureBinding,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {
+      .width = width,
+      .height = height,
+      .depthOrArrayLayers = 1,
+    },
+    .format = wgpu::TextureFormat::R32Float,
+    .mipLevelCount = m_mipCount,
+    .sampleCount = 1,
+  };
+
+	m_texture = device.CreateTexture(&textureDesc);
+
+	wgpu::TextureViewDescriptor viewDesc = {
+		.format = wgpu::TextureFormat::R32Float,
+		.dimension = wgpu::TextureViewDimension::e2D,
+		.baseMipLevel = 0,
+		.mipLevelCount = m_mipCount,
+		.baseArrayLayer = 0,
+		.arrayLayerCount = 1,
+		.aspect = wgpu::TextureAspect::All,
+	};
+
+	m_view = m_texture.CreateView(&viewDesc);
+
+	for (uint32_t level = 0; level < m_mipCount; level++) {
+		wgpu::TextureView source = depthView;
+		if (level > 0) {
+			source = CreateLevelView(level - 1);
+		}
+
+		wgpu::BindGroupEntry entries[2] = {
+			{
+				.binding = 0,
+				.textureView = source,
+			},
+			{
+				.binding = 1,
+				.textureView = CreateLevelView(level),
+			},
+		};
+
+		ComputePipeline &pipeline = level == 0 ? m_copyPipeline :
+							 m_downsamplePipeline;
+
+		wgpu::BindGroupDescriptor bindGroupDesc = {
+			.layout = pipeline.GetBindGroupLayout(),
+			.entryCount = 2,
+			.entries = entries,
+		};
+
+		m_bindGroups.push_back(device.CreateBindGroup(&bindGroupDesc));
+	}
+}
+
+void DepthPyramid::Release()
+{
+	m_bindGroups.clear();
+	m_view = nullptr;
+	m_texture = nullptr;
+
+	m_downsamplePipeline.Release();
+	m_copyPipeline.Release();
+
+	m_width = 0;
+	m_height = 0;
+	m_mipCount = 0;
+}
+
+void DepthPyramid::Build(wgpu::CommandEncoder &encoder)
+{
+	wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+
+	for (uint32_t level = 0; level < m_mipCount; level++) {
+		uint32_t width = std::max(m_width >> level, 1u);
+		uint32_t height = std::max(m_height >> level, 1u);
+
+		ComputePipeline &pipeline = level == 0 ? m_copyPipeline :
+							 m_downsamplePipeline;
+
+		pass.SetPipeline(pipeline.GetPipeline());
+		pass.SetBindGroup(0, m_bindGroups[level]);
+		pass.DispatchWorkgroups((width + 7) / 8, (height + 7) / 8);
+	}
+
+	pass.End();
+}
+
+wgpu::TextureView DepthPyramid::CreateLevelView(uint32_t level)
+{
+	wgpu::TextureViewDescriptor viewDesc = {
+		.format = wgpu::TextureFormat::R32Float,
+		.dimension = wgpu::TextureViewDimension::e2D,
+		.baseMipLevel = level,
+		.mipLevelCount = 1,
+		.baseArrayLayer = 0,
+		.arrayLayerCount = 1,
+		.aspect = wgpu::TextureAspect::All,
+	};
+
+	return m_texture.CreateView(&viewDesc);
+}
@@ -1,14 +1,25 @@
+#include "allocator.h"
 #include "app.h"
+#include "archive.h"
+#include "bounds.h"
 #include "config.h"
+#include "cooked.h"
 #include "entrypoint.h"
+#include "frustum.h"
+#include "hiz.h"
 
+#include "mesher.h"
+#include "occlusion.h"
 #include "pipeline.h"
+#include "rasterizer.h"
+#include "resolution.h"
+#include "sort.h"
 #include "ssbo.h"
 #include "texture.h"
 #include "uniform.h"
+#include "world.h"
 
 #include <algorithm>
-#include <fstream>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -16,72 +27,7 @@
 
 #include <optional>
 #include <stb_image.h>
-
-#define WORLD_SIZE 32
-
-// clang-format off
-static std::vector<float> vertexData({
-    // Front face (Z+)
-    // Triangle 1
-    -0.5f, -0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-     0.5f, -0.5f,  0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-     0.5f,  0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    // Triangle 2
-     0.5f,  0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    -0.5f,  0.5f,  0.5f, 1.0f,   0.0f, 1.0f,  // Top-left
-    -0.5f, -0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-
-    // Back face (Z-)
-    // Triangle 1
-     0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left (from back view)
-    -0.5f, -0.5f, -0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right (from back view)
-    -0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right (from back view)
-    // Triangle 2
-    -0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right (from back view)
-     0.5f,  0.5f, -0.5f, 1.0f,   0.0f, 1.0f,  // Top-left (from back view)
-     0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left (from back view)
-
-    // Right face (X+)
-    // Triangle 1
-     0.5f, -0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-     0.5f, -0.5f, -0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-     0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    // Triangle 2
-     0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-     0.5f,  0.5f,  0.5f, 1.0f,   0.0f, 1.0f,  // Top-left
-     0.5f, -0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-
-    // Left face (X-)
-    // Triangle 1
-    -0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-    -0.5f, -0.5f,  0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-    -0.5f,  0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    // Triangle 2
-    -0.5f,  0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    -0.5f,  0.5f, -0.5f, 1.0f,   0.0f, 1.0f,  // Top-left
-    -0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-
-    // Top face (Y+)
-    // Triangle 1
-    -0.5f,  0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-     0.5f,  0.5f,  0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-     0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    // Triangle 2
-     0.5f,  0.5f, -0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    -0.5f,  0.5f, -0.5f, 1.0f,   0.0f, 1.0f,  // Top-left
-    -0.5f,  0.5f,  0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-
-    // Bottom face (Y-)
-    // Triangle 1
-    -0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-     0.5f, -0.5f, -0.5f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-     0.5f, -0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    // Triangle 2
-     0.5f, -0.5f,  0.5f, 1.0f,   1.0f, 1.0f,  // Top-right
-    -0.5f, -0.5f,  0.5f, 1.0f,   0.0f, 1.0f,  // Top-left
-    -0.5f, -0.5f, -0.5f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-});
-// clang-format on
+#include <unordered_map>
 
 struct RayCast {
   glm::vec3 origin;
@@ -93,84 +39,206 @@ struct RayHit {
   glm::ivec3 adj;
 };
 
-class BlockGameApplication : public Application {
-public:
-  std::string LoadSource(const char *path) {
-    std::ifstream file(path);
-    LOG_CRITICAL_IF(Default, !file, "Failed to open file {}!", path);
+// Size of the vertex buffer shared by all chunk meshes.
+constexpr uint32_t kVertexPoolSize = 32 << 20;
+
+// Software occlusion buffer size, and which faces of which chunks are
+// drawn into it.
+constexpr uint32_t kRasterWidth = 256;
+constexpr uint32_t kRasterHeight = 144;
+constexpr uint32_t kOccluderMinArea = 16;
+constexpr uint32_t kOccludersPerChunk = 16;
+constexpr uint32_t kOccluderChunks = 64;
+
+// Texture of each block type, one array layer each from BLOCK_COBBLESTONE
+// on, see shader.wgsl. The same list is cooked by BLOCK_TEXTURES in
+// src/CMakeLists.txt.
+static const char *kBlockTextures[] = {
+    "cobblestone.png",
+};
 
-    std::string str;
+// Padding of the slot order read by the cull pass.
+constexpr uint32_t kNoSlot = ~0u;
+
+// Mesh of a chunk whose uploads the uploader may have deferred, see
+// BlockGameApplication::UpdateMesh.
+struct PendingMesh {
+  // Ticket of the slot upload, made after the vertex upload.
+  uint64_t ticket = 0;
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t quadCount = 0;
+  uint32_t faceQuads[FACE_COUNT] = {};
+  uint64_t visibility = VISIBILITY_ALL;
+  std::vector<OccluderQuad> occluders;
+};
 
-    file.seekg(0, std::ios::end);
-    str.reserve(file.tellg());
-    file.seekg(0, std::ios::beg);
+struct ChunkRenderData {
+  glm::ivec3 coord;
+  uint32_t slot;
+  // Range of the chunk's mesh in the shared vertex buffer.
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t quadCount = 0;
+  // Quads per face direction, see ChunkMesh::faceQuads.
+  uint32_t faceQuads[FACE_COUNT] = {};
+  // Face connectivity through the chunk, see ChunkMesh::visibility.
+  uint64_t visibility = VISIBILITY_ALL;
+  // Last walk of UpdateReachable that reached the chunk.
+  uint32_t walk = 0;
+  // Largest faces of the mesh, see OcclusionRasterizer::FindOccluders.
+  std::vector<OccluderQuad> occluders;
+  // Draw commands of each face direction of the chunk, recorded again
+  // whenever the mesh or the shared index buffer changes.
+  wgpu::RenderBundle bundles[FACE_COUNT];
+  // Replaces the mesh above once its uploads are staged.
+  std::optional<PendingMesh> pending;
+};
 
-    str.assign(std::istreambuf_iterator<char>(file),
-               std::istreambuf_iterator<char>());
+// Face direction of a chunk drawn this frame, see
+// BlockGameApplication::CollectVisible.
+struct ChunkFace {
+  ChunkRenderData *data;
+  int face;
+};
 
-    return str;
-  }
+// Chunk visited by BlockGameApplication::UpdateReachable.
+struct ChunkWalkStep {
+  glm::ivec3 coord;
+  ChunkRenderData *data;
+  // Face the walk entered through, -1 for the camera's chunk.
+  int from;
+  // Directions taken so far, one bit per face.
+  uint32_t directions;
+};
 
-  int GetBlockIdx(int x, int y, int z) {
-    return z + WORLD_SIZE * (y + WORLD_SIZE * x);
+class BlockGameApplication : public Application {
+public:
+  // Shader source straight from the asset archive.
+  const char *LoadSource(const char *name) {
+    const char *src = m_assets.FindText(name);
+    LOG_CRITICAL_IF(Default, !src, "Missing asset {}!", name);
+    return src;
   }
 
-  uint32_t GetSSBOElementSize() {
-    uint32_t minSSBOStride = GetMinSSBOStride();
-    return (sizeof(SSBOData) + minSSBOStride - 1) / minSSBOStride *
-           minSSBOStride;
-  }
+  // Runs while the adapter and device are requested. Nothing here may
+  // touch the GPU, Init waits for the tasks and uploads the results.
+  virtual void Prepare() override {
+    // Packed at build time next to the executable, see tools/packer.cpp.
+    LOG_CRITICAL_IF(Default, !m_assets.Open("./assets.pak"),
+                    "Failed to open the asset archive!");
 
-  virtual void Init() override {
-    std::string code = LoadSource("./assets/shader.wgsl");
-    m_pipeline.Create(GetDevice(), code.c_str(), GetSurfaceFormat());
+    WorkerPool &workers = GetWorkers();
 
-    m_vertexBuffer =
-        CreateBuffer(vertexData.data(), vertexData.size() * sizeof(float),
-                     wgpu::BufferUsage::Vertex);
+    workers.Start([this] { PrepareTextures(); });
+    workers.Start([this] {
+      m_cameraPos = glm::vec3(CHUNK_SIZE / 2, 4, CHUNK_SIZE / 2);
+      m_world.Update(m_cameraPos);
+    });
+  }
 
-    auto &window = GetWindow();
+  // Only reads the world's render distance, which the Prepare tasks leave
+  // alone.
+  virtual void RequireLimits(wgpu::Limits &limits) override {
+    // The largest storage binding holds an indirect draw record per face
+    // direction of every chunk slot, see m_drawBuffer.
+    limits.maxStorageBufferBindingSize = sizeof(DrawIndexedIndirectArgs) *
+                                         FACE_COUNT *
+                                         m_world.GetMaxLoadedChunks();
+    // The shared vertex pool is the largest buffer, unless that binding
+    // outgrows it.
+    limits.maxBufferSize = std::max<uint64_t>(
+        kVertexPoolSize, limits.maxStorageBufferBindingSize);
+  }
 
-    m_uniformData.proj = glm::perspective(
-        90.0f, (float)window.GetWidth() / window.GetHeight(), 0.1f, 100.0f);
+  virtual void Init() override {
+    // Compiled in the background while the tasks started by Prepare finish
+    // and the rest is set up, see the Wait at the end.
+    const char *code = LoadSource("shader.wgsl");
+    m_pipeline.Create(GetDevice(), code, GetSurfaceFormat());
+
+    // The scene is drawn at the size of the dynamic resolution target, and
+    // so is the depth buffer.
+    const char *blitCode = LoadSource("blit.wgsl");
+    m_resolution.Create(GetDevice(), blitCode, GetSurfaceFormat(),
+                        GetSurfaceWidth(), GetSurfaceHeight(),
+                        Config::Get().GetTargetFrameTime());
+    m_pipeline.Resize(GetDevice(), m_resolution.GetWidth(),
+                      m_resolution.GetHeight());
+
+    m_uniformData.proj =
+        glm::perspective(90.0f, (float)GetSurfaceWidth() / GetSurfaceHeight(),
+                         0.1f, 100.0f);
 
     m_uniformData.view = glm::mat4(1.0f);
 
     m_uniformBuffer = CreateBuffer(&m_uniformData, sizeof(m_uniformData),
                                    wgpu::BufferUsage::Uniform);
 
-    uint32_t ssboElementSize = GetSSBOElementSize();
+    uint32_t maxChunks = m_world.GetMaxLoadedChunks();
 
-    m_ssbo = CreateBuffer(
-        nullptr, ssboElementSize * WORLD_SIZE * WORLD_SIZE * WORLD_SIZE,
-        wgpu::BufferUsage::Storage);
+    m_ssbo = CreateBuffer(nullptr, sizeof(SSBOData) * maxChunks,
+                          wgpu::BufferUsage::Storage);
 
-    for (int x = 0; x < WORLD_SIZE; x++) {
-      for (int y = 0; y < WORLD_SIZE; y++) {
-        for (int z = 0; z < WORLD_SIZE; z++) {
-          int idx = GetBlockIdx(x, y, z);
+    for (uint32_t slot = maxChunks; slot > 0; slot--) {
+      m_freeSlots.push_back(slot - 1);
+    }
 
-          SSBOData data;
+    m_bounds.Create(maxChunks);
 
-          data.model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+    // One bit per chunk slot, written every frame.
+    m_reachable.assign((maxChunks + 31) / 32, ~0u);
+    m_reachableBuffer = CreateBuffer(nullptr,
+                                     m_reachable.size() * sizeof(uint32_t),
+                                     wgpu::BufferUsage::Storage);
 
-          GetDevice().GetQueue().WriteBuffer(m_ssbo, ssboElementSize * idx,
-                                             &data, sizeof(data));
-        }
-      }
-    }
+    // Slots in drawing order, written every frame. The sort keeps chunk
+    // indices in 16 bits.
+    LOG_CRITICAL_IF(Default, maxChunks > 0xffff, "Too many chunks to sort!");
+    m_orderSlots.assign(maxChunks, kNoSlot);
+    m_orderBuffer = CreateBuffer(nullptr, maxChunks * sizeof(uint32_t),
+                                 wgpu::BufferUsage::Storage);
 
-    m_cameraPos = glm::vec3(WORLD_SIZE / 2, 4, WORLD_SIZE / 2);
+    m_vertexBuffer =
+        CreateBuffer(nullptr, kVertexPoolSize, wgpu::BufferUsage::Vertex);
+    m_vertexAllocator.Create(kVertexPoolSize / sizeof(ChunkVertex));
+
+    // One draw per face direction of every chunk.
+    m_drawBuffer = CreateBuffer(nullptr,
+                                sizeof(DrawIndexedIndirectArgs) * maxChunks *
+                                    FACE_COUNT,
+                                wgpu::BufferUsage::Storage |
+                                    wgpu::BufferUsage::Indirect);
+    m_drawCountBuffer =
+        CreateBuffer(nullptr, sizeof(uint32_t),
+                     wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect);
+
+    // Indirect draws pass the chunk slot as their first instance.
+    wgpu::Device &device = GetDevice();
+    m_indirect = device.HasFeature(wgpu::FeatureName::IndirectFirstInstance);
+    m_multiDraw = device.HasFeature(wgpu::FeatureName::MultiDrawIndirect);
 
-    stbi_set_flip_vertically_on_load(true);
+    m_mesher.SetMode(MESHING_BINARY);
+    m_prepass = Config::Get().GetDepthPrepass();
 
-    int image_width, image_height, image_channels;
-    unsigned char *image = stbi_load("./assets/cobblestone.png", &image_width,
-                                     &image_height, &image_channels, 0);
+    const char *boxCode = LoadSource("box.wgsl");
+    m_queries.Create(GetDevice(), boxCode, m_pipeline, maxChunks);
 
-    m_texture.Create(GetDevice(), image, image_width, image_height);
+    // The pyramid has the size of the depth buffer, see RenderPipeline.
+    const char *hizCode = LoadSource("hiz.wgsl");
+    m_hiz.Create(GetDevice(), hizCode,
+                 m_pipeline.GetDepthStencilView(), m_resolution.GetWidth(),
+                 m_resolution.GetHeight());
 
-    stbi_image_free(image);
+    const char *cullCode = LoadSource("cull.wgsl");
+    m_cullPipeline.Create(GetDevice(), cullCode, "cs_main",
+                          GetCullLayoutEntries());
+    CreateCullBindGroup();
+
+    // Everything above needs neither the textures nor the world.
+    GetWorkers().Wait();
+
+    UploadTextures();
 
     std::vector<wgpu::BindGroupEntry> entries = {
         wgpu::BindGroupEntry{
@@ -183,11 +251,15 @@ public:
             .binding = 1,
             .buffer = m_ssbo,
             .offset = 0,
-            .size = sizeof(SSBOData),
+            .size = sizeof(SSBOData) * maxChunks,
         },
         wgpu::BindGroupEntry{
             .binding = 2,
             .textureView = m_texture.GetView(),
+        },
+        wgpu::BindGroupEntry{
+            .binding = 3,
+            .sampler = m_texture.GetSampler(),
         }};
 
     wgpu::BindGroupDescriptor bindGroupDesc = {
@@ -198,27 +270,770 @@ public:
 
     m_bindGroup = GetDevice().CreateBindGroup(&bindGroupDesc);
 
-    for (int x = 0; x < WORLD_SIZE; x++) {
-      for (int y = 0; y < WORLD_SIZE; y++) {
-        for (int z = 0; z < WORLD_SIZE; z++) {
-          m_world[x][y][z] = (y < 3);
+    m_rasterizer.Create(kRasterWidth, kRasterHeight);
+
+    m_pipeline.Wait(GetInstance());
+    m_resolution.Wait(GetInstance());
+    m_texture.Wait(GetInstance());
+    m_queries.Wait(GetInstance());
+    m_hiz.Wait(GetInstance());
+    m_cullPipeline.Wait(GetInstance());
+
+    LOG_INFO(Default, "GPU-driven drawing: {}, multi-draw: {}",
+             m_indirect ? "available" : "unavailable",
+             m_multiDraw ? "available" : "unavailable");
+    LOG_INFO(Default, "Dynamic resolution: {}",
+             m_resolution.IsSupported() ? "available" : "unavailable");
+  }
+
+  // Cooked at build time, decoding the PNGs is the fallback for archives
+  // without the cooked textures. Runs on a worker, see Prepare.
+  void PrepareTextures() {
+    if (!FindCookedTextures("blocks.tex")) {
+      LOG_WARN(Default, "No cooked block textures, decoding them instead");
+      DecodeTextures();
+    }
+  }
+
+  // Points m_textureLevels at the block textures cooked by
+  // tools/cooker.cpp with all their levels, returns false when the file is
+  // missing or does not match kBlockTextures.
+  bool FindCookedTextures(const char *name) {
+    std::span<const uint8_t> data = m_assets.Find(name);
+    if (data.empty()) {
+      return false;
+    }
+
+    if (!IsCookedTextureValid(data.data(), data.size())) {
+      LOG_WARN(Default, "Cooked texture {} is invalid!", name);
+      return false;
+    }
+
+    const auto &header =
+        *reinterpret_cast<const CookedTextureHeader *>(data.data());
+
+    if (header.layerCount != std::size(kBlockTextures)) {
+      LOG_WARN(Default, "Cooked texture {} has {} layers, expected {}!", name,
+               header.layerCount, std::size(kBlockTextures));
+      return false;
+    }
+
+    uint32_t mipCount = Texture::CountMips(header.width, header.height);
+    if (header.mipCount != mipCount) {
+      LOG_WARN(Default, "Cooked texture {} has {} levels, expected {}!", name,
+               header.mipCount, mipCount);
+      return false;
+    }
+
+    // Uploaded from the archive, the uploader's staging copy is the only
+    // one.
+    const uint8_t *texels = data.data() + sizeof(header);
+
+    for (uint32_t layer = 0; layer < header.layerCount; layer++) {
+      for (uint32_t level = 0; level < header.mipCount; level++) {
+        m_textureLevels.push_back(texels);
+        texels += GetCookedLevelSize(header, level);
+      }
+    }
+
+    m_textureWidth = header.width;
+    m_textureHeight = header.height;
+    m_textureCooked = true;
+    return true;
+  }
+
+  // Decodes the block textures, their levels are generated on the GPU.
+  // Every layer has the size of the first one.
+  void DecodeTextures() {
+    stbi_set_flip_vertically_on_load(true);
+
+    uint32_t layerCount = std::size(kBlockTextures);
+    m_decodedTextures.resize(layerCount);
+
+    for (uint32_t layer = 0; layer < layerCount; layer++) {
+      std::span<const uint8_t> png = m_assets.Find(kBlockTextures[layer]);
+
+      int image_width, image_height, image_channels;
+      unsigned char *image =
+          stbi_load_from_memory(png.data(), png.size(), &image_width,
+                                &image_height, &image_channels, 4);
+      LOG_CRITICAL_IF(Default, !image, "Failed to load {}!",
+                      kBlockTextures[layer]);
+
+      if (layer == 0) {
+        m_textureWidth = image_width;
+        m_textureHeight = image_height;
+      }
+
+      LOG_CRITICAL_IF(Default,
+                      uint32_t(image_width) != m_textureWidth ||
+                          uint32_t(image_height) != m_textureHeight,
+                      "Block texture {} has the wrong size!",
+                      kBlockTextures[layer]);
+
+      m_decodedTextures[layer].assign(image,
+                                      image + 4 * m_textureWidth *
+                                                  m_textureHeight);
+      m_textureLevels.push_back(m_decodedTextures[layer].data());
+      stbi_image_free(image);
+    }
+
+    m_textureCooked = false;
+  }
+
+  // Creates the block texture array from what PrepareTextures found.
+  void UploadTextures() {
+    uint32_t layerCount = std::size(kBlockTextures);
+    const char *mipCode = m_textureCooked ? nullptr : LoadSource("mipmap.wgsl");
+
+    m_texture.Create(GetDevice(), mipCode, m_textureWidth, m_textureHeight,
+                     layerCount);
+
+    uint32_t levelCount = m_textureCooked ? m_texture.GetMipCount() : 1;
+
+    for (uint32_t layer = 0; layer < layerCount; layer++) {
+      for (uint32_t level = 0; level < levelCount; level++) {
+        const uint8_t *texels = m_textureLevels[layer * levelCount + level];
+
+        if (m_textureCooked) {
+          m_texture.UploadLevel(GetUploader(), layer, level, texels);
+        } else {
+          m_texture.UploadLayer(GetUploader(), layer, texels);
+        }
+      }
+    }
+
+    // The uploader copied the decoded layers into its staging buffer.
+    m_textureLevels.clear();
+    m_decodedTextures.clear();
+  }
+
+  // Bindings of cull.wgsl, in the order of CreateCullBindGroup.
+  static std::vector<wgpu::BindGroupLayoutEntry> GetCullLayoutEntries() {
+    auto storage = [](uint32_t binding, wgpu::BufferBindingType type) {
+      return wgpu::BindGroupLayoutEntry{
+          .binding = binding,
+          .visibility = wgpu::ShaderStage::Compute,
+          .buffer = {.type = type},
+      };
+    };
+
+    return {
+        storage(0, wgpu::BufferBindingType::ReadOnlyStorage),
+        storage(1, wgpu::BufferBindingType::Storage),
+        storage(2, wgpu::BufferBindingType::Storage),
+        wgpu::BindGroupLayoutEntry{
+            .binding = 3,
+            .visibility = wgpu::ShaderStage::Compute,
+            .buffer =
+                {
+                    .type = wgpu::BufferBindingType::Uniform,
+                    .minBindingSize = sizeof(UniformData),
+                },
+        },
+        wgpu::BindGroupLayoutEntry{
+            .binding = 4,
+            .visibility = wgpu::ShaderStage::Compute,
+            .texture =
+                {
+                    .sampleType = wgpu::TextureSampleType::UnfilterableFloat,
+                    .viewDimension = wgpu::TextureViewDimension::e2D,
+                },
+        },
+        storage(5, wgpu::BufferBindingType::ReadOnlyStorage),
+        storage(6, wgpu::BufferBindingType::ReadOnlyStorage),
+    };
+  }
+
+  // The cull pass reads the pyramid, so its bind group is recreated along
+  // with it.
+  void CreateCullBindGroup() {
+    uint32_t maxChunks = m_world.GetMaxLoadedChunks();
+
+    std::vector<wgpu::BindGroupEntry> cullEntries = {
+        wgpu::BindGroupEntry{
+            .binding = 0,
+            .buffer = m_ssbo,
+            .offset = 0,
+            .size = sizeof(SSBOData) * maxChunks,
+        },
+        wgpu::BindGroupEntry{
+            .binding = 1,
+            .buffer = m_drawBuffer,
+            .offset = 0,
+            .size = sizeof(DrawIndexedIndirectArgs) * maxChunks * FACE_COUNT,
+        },
+        wgpu::BindGroupEntry{
+            .binding = 2,
+            .buffer = m_drawCountBuffer,
+            .offset = 0,
+            .size = sizeof(uint32_t),
+        },
+        wgpu::BindGroupEntry{
+            .binding = 3,
+            .buffer = m_uniformBuffer,
+            .offset = 0,
+            .size = sizeof(m_uniformData),
+        },
+        wgpu::BindGroupEntry{
+            .binding = 4,
+            .textureView = m_hiz.GetView(),
+        },
+        wgpu::BindGroupEntry{
+            .binding = 5,
+            .buffer = m_reachableBuffer,
+            .offset = 0,
+            .size = m_reachable.size() * sizeof(uint32_t),
+        },
+        wgpu::BindGroupEntry{
+            .binding = 6,
+            .buffer = m_orderBuffer,
+            .offset = 0,
+            .size = maxChunks * sizeof(uint32_t),
+        }};
+
+    wgpu::BindGroupDescriptor cullBindGroupDesc = {
+        .layout = m_cullPipeline.GetBindGroupLayout(),
+        .entryCount = cullEntries.size(),
+        .entries = cullEntries.data(),
+    };
+
+    m_cullBindGroup = GetDevice().CreateBindGroup(&cullBindGroupDesc);
+  }
+
+  // Recreates the depth buffer and everything sized like it once the
+  // dynamic resolution target changed size. The new pyramid is empty until
+  // the end of the frame.
+  void ResizeTargets() {
+    uint32_t width = m_resolution.GetWidth();
+    uint32_t height = m_resolution.GetHeight();
+
+    m_pipeline.Resize(GetDevice(), width, height);
+    m_hiz.Resize(GetDevice(), m_pipeline.GetDepthStencilView(), width, height);
+    m_hizBuilt = false;
+
+    CreateCullBindGroup();
+  }
+
+  virtual void Resize(uint32_t width, uint32_t height) override {
+    m_uniformData.proj =
+        glm::perspective(90.0f, (float)width / height, 0.1f, 100.0f);
+
+    m_resolution.SetOutputSize(width, height);
+  }
+
+  // Writes the chunk's origin and mesh range to its SSBO slot, returns the
+  // upload's ticket.
+  uint64_t UploadSlot(const Chunk &chunk, uint32_t slot,
+                      const PendingMesh &mesh) {
+    SSBOData ssboData = {};
+    ssboData.origin = glm::ivec4(chunk.GetOrigin(), 0);
+    ssboData.mesh = glm::uvec4(mesh.quadCount, mesh.firstVertex, 0, 0);
+
+    for (int face = 0; face < FACE_COUNT; face++) {
+      ssboData.faces[face / 2] |= mesh.faceQuads[face] << (16 * (face % 2));
+    }
+
+    return GetUploader().Upload(m_ssbo, slot * sizeof(SSBOData), &ssboData,
+                                sizeof(ssboData));
+  }
+
+  // Re-meshes a chunk and uploads the result to a new range of the shared
+  // vertex buffer, growing the shared quad index buffer as needed. The
+  // chunk keeps drawing its current mesh until ApplyMesh.
+  void UpdateMesh(Chunk &chunk, ChunkRenderData &data) {
+    m_mesher.Mesh(m_world, chunk, m_mesh);
+
+    // A mesh still waiting is dropped, its uploads land before the new
+    // ones and nothing draws its range.
+    if (data.pending) {
+      m_vertexAllocator.Free(data.pending->firstVertex,
+                             data.pending->vertexCount);
+    }
+
+    PendingMesh &mesh = data.pending.emplace();
+    mesh.vertexCount = m_mesh.vertices.size();
+    mesh.quadCount = m_mesh.GetQuadCount();
+    mesh.visibility = m_mesh.visibility;
+    std::copy(std::begin(m_mesh.faceQuads), std::end(m_mesh.faceQuads),
+              std::begin(mesh.faceQuads));
+
+    OcclusionRasterizer::FindOccluders(m_mesh, chunk.GetOrigin(),
+                                       kOccluderMinArea, kOccludersPerChunk,
+                                       mesh.occluders);
+
+    if (mesh.vertexCount > 0 &&
+        !m_vertexAllocator.Allocate(mesh.vertexCount, mesh.firstVertex)) {
+      LOG_ERROR(Default, "Out of vertex memory for chunk ({}, {}, {})!",
+                chunk.GetCoord().x, chunk.GetCoord().y, chunk.GetCoord().z);
+
+      mesh.vertexCount = 0;
+      mesh.quadCount = 0;
+      std::fill(std::begin(mesh.faceQuads), std::end(mesh.faceQuads), 0);
+    }
+
+    if (mesh.vertexCount > 0) {
+      GetUploader().Upload(m_vertexBuffer,
+                           mesh.firstVertex * sizeof(ChunkVertex),
+                           m_mesh.vertices.data(),
+                           mesh.vertexCount * sizeof(ChunkVertex));
+    }
+
+    mesh.ticket = UploadSlot(chunk, data.slot, mesh);
+
+    if (mesh.quadCount > m_indexCapacity) {
+      m_indexCapacity = std::max(mesh.quadCount, m_indexCapacity * 2);
+
+      std::vector<uint32_t> indices = Mesher::GetQuadIndices(m_indexCapacity);
+      m_indexBuffer =
+          CreateBuffer(indices.data(), indices.size() * sizeof(uint32_t),
+                       wgpu::BufferUsage::Index);
+
+      // Every bundle references the old index buffer, and is recorded
+      // again this frame whether or not a new mesh is applied.
+      for (auto &[key, other] : m_chunkData) {
+        std::fill(std::begin(other.bundles), std::end(other.bundles), nullptr);
+      }
+
+      m_bundlesDirty = true;
+    }
+
+    chunk.SetDirty(false);
+  }
+
+  // Switches a chunk to its pending mesh once the uploads it depends on
+  // are staged, so they are submitted before this frame's draws.
+  void ApplyMesh(ChunkRenderData &data) {
+    if (!data.pending || !GetUploader().IsStaged(data.pending->ticket)) {
+      return;
+    }
+
+    PendingMesh &mesh = *data.pending;
+
+    // The slot pointed at the old range until the upload staged now, so
+    // no draw submitted from here on reads it, and uploads of its next
+    // owner are staged after.
+    m_vertexAllocator.Free(data.firstVertex, data.vertexCount);
+
+    data.firstVertex = mesh.firstVertex;
+    data.vertexCount = mesh.vertexCount;
+    data.quadCount = mesh.quadCount;
+    data.visibility = mesh.visibility;
+    std::copy(std::begin(mesh.faceQuads), std::end(mesh.faceQuads),
+              std::begin(data.faceQuads));
+    data.occluders = std::move(mesh.occluders);
+    data.pending.reset();
+
+    std::fill(std::begin(data.bundles), std::end(data.bundles), nullptr);
+    m_bundlesDirty = true;
+  }
+
+  // Quads are sorted by face, see ChunkMesh::faceQuads.
+  static uint32_t GetFirstQuad(const ChunkRenderData &data, int face) {
+    uint32_t firstQuad = 0;
+    for (int other = 0; other < face; other++) {
+      firstQuad += data.faceQuads[other];
+    }
+
+    return firstQuad;
+  }
+
+  void RecordBundle(ChunkRenderData &data, int face) {
+    uint32_t firstQuad = GetFirstQuad(data, face);
+
+    wgpu::RenderBundleEncoder encoder =
+        m_pipeline.CreateBundleEncoder(GetDevice());
+
+    encoder.SetPipeline(m_pipeline.GetPipeline());
+    encoder.SetBindGroup(0, m_bindGroup);
+    encoder.SetIndexBuffer(m_indexBuffer, wgpu::IndexFormat::Uint32);
+    encoder.SetVertexBuffer(0, m_vertexBuffer);
+
+    // The chunk's SSBO slot is passed as the instance index.
+    encoder.DrawIndexed(data.faceQuads[face] * 6, 1, 0,
+                        data.firstVertex + firstQuad * 4, data.slot);
+
+    data.bundles[face] = encoder.Finish();
+  }
+
+  // Whether any face of the direction in the chunk can face the camera.
+  // Faces pointing along +x lie on planes past the chunk's min x, so they
+  // can only face a camera past it, and so on. Same test as facesCamera in
+  // cull.wgsl.
+  bool FacesCamera(const ChunkRenderData &data, int face) const {
+    int axis = face / 2;
+    float min = data.coord[axis] * CHUNK_SIZE - 0.5f;
+
+    if (face % 2 == 0) {
+      return m_cameraPos[axis] > min;
+    }
+
+    return m_cameraPos[axis] < min + CHUNK_SIZE;
+  }
+
+  // Mirrors the loaded chunks of m_world into per-chunk GPU state: frees
+  // the SSBO slots of unloaded chunks, assigns slots to new ones and
+  // re-meshes dirty ones.
+  void SyncChunks() {
+    for (auto it = m_chunkData.begin(); it != m_chunkData.end();) {
+      if (m_world.GetChunks().count(it->first) == 0) {
+        ChunkRenderData &data = it->second;
+
+        // Clear the slot so the cull pass stops drawing it.
+        SSBOData ssboData = {};
+        GetUploader().Upload(m_ssbo, data.slot * sizeof(SSBOData), &ssboData,
+                             sizeof(ssboData));
+
+        m_vertexAllocator.Free(data.firstVertex, data.vertexCount);
+        if (data.pending) {
+          m_vertexAllocator.Free(data.pending->firstVertex,
+                                 data.pending->vertexCount);
+        }
+
+        m_freeSlots.push_back(data.slot);
+        it = m_chunkData.erase(it);
+        m_bundlesDirty = true;
+      } else {
+        ++it;
+      }
+    }
+
+    for (auto &[key, chunk] : m_world.GetChunks()) {
+      auto it = m_chunkData.find(key);
+
+      if (it == m_chunkData.end()) {
+        LOG_CRITICAL_IF(Default, m_freeSlots.empty(),
+                        "Out of chunk SSBO slots!");
+
+        // The slot is written once the chunk is meshed below.
+        ChunkRenderData data;
+        data.coord = chunk->GetCoord();
+        data.slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+
+        // Results of the slot's previous chunk are still in flight.
+        m_queries.Invalidate(data.slot);
+
+        // Blocks are centred on their integer coordinates.
+        glm::vec3 min = glm::vec3(chunk->GetOrigin()) - 0.5f;
+        m_bounds.Set(data.slot, min, min + glm::vec3(CHUNK_SIZE));
+
+        it = m_chunkData.emplace(key, std::move(data)).first;
+        chunk->SetDirty(true);
+      }
+
+      if (chunk->IsDirty()) {
+        UpdateMesh(*chunk, it->second);
+      }
+
+      ApplyMesh(it->second);
+    }
+
+    if (!m_bundlesDirty) {
+      return;
+    }
+
+    m_drawCount = 0;
+
+    for (auto &[key, data] : m_chunkData) {
+      for (int face = 0; face < FACE_COUNT; face++) {
+        if (data.faceQuads[face] == 0) {
+          continue;
+        }
+
+        m_drawCount++;
+
+        if (!data.bundles[face]) {
+          RecordBundle(data, face);
+        }
+      }
+    }
+
+    m_bundlesDirty = false;
+  }
+
+  // Marks the chunks the camera can see into through air. Starting at the
+  // camera's chunk, the walk crosses from a chunk into its neighbour only
+  // if the face it entered through connects to the face it leaves through,
+  // and never turns back toward the camera. Chunks outside the frustum are
+  // not walked through.
+  void UpdateReachable() {
+    glm::ivec3 cameraBlock = glm::floor(m_cameraPos + 0.5f);
+    glm::ivec3 start = World::GetChunkCoord(cameraBlock);
+
+    auto it = m_chunkData.find(World::GetChunkKey(start));
+    if (!m_caveCulling || it == m_chunkData.end()) {
+      std::fill(m_reachable.begin(), m_reachable.end(), ~0u);
+      return;
+    }
+
+    std::fill(m_reachable.begin(), m_reachable.end(), 0u);
+
+    m_walkId++;
+    m_walk.clear();
+    m_walk.push_back({start, &it->second, -1, 0});
+    it->second.walk = m_walkId;
+
+    for (size_t i = 0; i < m_walk.size(); i++) {
+      ChunkWalkStep step = m_walk[i];
+      uint32_t slot = step.data->slot;
+      m_reachable[slot / 32] |= 1u << (slot % 32);
+
+      for (int face = 0; face < FACE_COUNT; face++) {
+        // Faces come in opposite pairs, see Face.
+        int opposite = face ^ 1;
+
+        if (step.directions & (1u << opposite)) {
+          continue;
+        }
+
+        if (step.from >= 0 &&
+            !IsFaceConnected(step.data->visibility, step.from, face)) {
+          continue;
+        }
+
+        glm::ivec3 coord = step.coord + Mesher::GetFaceNormal(Face(face));
+
+        auto next = m_chunkData.find(World::GetChunkKey(coord));
+        if (next == m_chunkData.end() || next->second.walk == m_walkId) {
+          continue;
         }
+
+        glm::vec3 min = glm::vec3(coord * CHUNK_SIZE) - 0.5f;
+        if (!m_uniformData.frustum.IntersectsBox(
+                min, min + glm::vec3(CHUNK_SIZE))) {
+          continue;
+        }
+
+        next->second.walk = m_walkId;
+        m_walk.push_back({coord, &next->second, opposite,
+                          step.directions | (1u << face)});
       }
     }
   }
 
+  inline bool IsReachable(uint32_t slot) const {
+    return (m_reachable[slot / 32] >> (slot % 32)) & 1;
+  }
+
+  // Orders the chunks with a mesh front to back into m_drawOrder, by the
+  // distance from the camera to their centre quantized to 1/16 block, so
+  // the nearest terrain fills the depth buffer first.
+  void SortChunks() {
+    m_sortChunks.clear();
+    m_sortKeys.clear();
+
+    glm::vec3 center = m_cameraPos - float(CHUNK_SIZE / 2 - 0.5f);
+
+    for (auto &[key, data] : m_chunkData) {
+      if (data.quadCount == 0) {
+        continue;
+      }
+
+      float distance =
+          glm::length(glm::vec3(data.coord * CHUNK_SIZE) - center);
+      uint32_t quantized = std::min(uint32_t(distance * 16.0f), 0xffffu);
+
+      m_sortKeys.push_back((quantized << 16) | m_sortChunks.size());
+      m_sortChunks.push_back(&data);
+    }
+
+    RadixSort16(m_sortKeys, m_sortScratch);
+
+    m_drawOrder.clear();
+    std::fill(m_orderSlots.begin(), m_orderSlots.end(), kNoSlot);
+
+    for (uint32_t key : m_sortKeys) {
+      ChunkRenderData *data = m_sortChunks[key & 0xffff];
+
+      m_orderSlots[m_drawOrder.size()] = data->slot;
+      m_drawOrder.push_back(data);
+    }
+  }
+
+  // Draws the occluders of the chunks nearest to the camera that are left
+  // by frustum and cave culling, then removes the chunks they hide from
+  // m_reachable.
+  void UpdateRasterOcclusion() {
+    if (!m_rasterCulling) {
+      return;
+    }
+
+    m_rasterChunks.clear();
+
+    // Nearest first, see SortChunks.
+    for (ChunkRenderData *data : m_drawOrder) {
+      if (m_bounds.IsVisible(data->slot) && IsReachable(data->slot)) {
+        m_rasterChunks.push_back(data);
+      }
+    }
+
+    uint32_t occluderChunks =
+        std::min<size_t>(m_rasterChunks.size(), kOccluderChunks);
+
+    m_rasterizer.Begin(m_uniformData.proj * m_uniformData.view);
+
+    for (uint32_t i = 0; i < occluderChunks; i++) {
+      for (const OccluderQuad &quad : m_rasterChunks[i]->occluders) {
+        m_rasterizer.AddOccluder(quad);
+      }
+    }
+
+    m_rasterizer.Rasterize(GetWorkers());
+
+    for (ChunkRenderData *data : m_rasterChunks) {
+      glm::vec3 min = glm::vec3(data->coord * CHUNK_SIZE) - 0.5f;
+      if (m_rasterizer.IsOccluded(min, min + glm::vec3(CHUNK_SIZE))) {
+        m_reachable[data->slot / 32] &= ~(1u << (data->slot % 32));
+      }
+    }
+  }
+
+  // Picks the chunks whose boxes are queried this frame, the non-empty
+  // ones left by frustum and cave culling, and removes the ones the latest
+  // query results reported occluded from m_reachable. Chunks the camera is
+  // inside of or next to are neither, their boxes reach past the near
+  // plane.
+  void UpdateOcclusion() {
+    m_queried.clear();
+
+    if (!m_queryCulling) {
+      return;
+    }
+
+    for (auto &[key, data] : m_chunkData) {
+      if (data.quadCount == 0 || !m_bounds.IsVisible(data.slot) ||
+          !IsReachable(data.slot)) {
+        continue;
+      }
+
+      glm::vec3 min = glm::vec3(data.coord * CHUNK_SIZE) - 0.5f;
+      glm::vec3 max = min + glm::vec3(CHUNK_SIZE);
+      if (glm::all(glm::greaterThan(m_cameraPos, min - 1.0f)) &&
+          glm::all(glm::lessThan(m_cameraPos, max + 1.0f))) {
+        continue;
+      }
+
+      m_queried.push_back(data.slot);
+
+      if (m_queries.IsOccluded(data.slot)) {
+        m_reachable[data.slot / 32] &= ~(1u << (data.slot % 32));
+      }
+    }
+  }
+
+  // Fills m_drawBuffer with the draw records of the non-empty chunk slots
+  // inside the view frustum and reachable by UpdateReachable, and when
+  // enabled not occluded according to the depth pyramid of the previous
+  // frame.
+  // Records past the draw count are left zeroed for the non-multi-draw
+  // path, which does not read the count.
+  void EncodeCull(wgpu::CommandEncoder &encoder) {
+    encoder.ClearBuffer(m_drawBuffer);
+    encoder.ClearBuffer(m_drawCountBuffer);
+
+    uint32_t slotCount = m_world.GetMaxLoadedChunks();
+
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+    pass.SetPipeline(m_cullPipeline.GetPipeline());
+    pass.SetBindGroup(0, m_cullBindGroup);
+    pass.DispatchWorkgroups((slotCount + 63) / 64);
+    pass.End();
+  }
+
+  void DrawIndirect(wgpu::RenderPassEncoder &pass,
+                    wgpu::RenderPipeline &pipeline) {
+    if (m_drawCount == 0) {
+      return;
+    }
+
+    pass.SetPipeline(pipeline);
+    pass.SetBindGroup(0, m_bindGroup);
+    pass.SetIndexBuffer(m_indexBuffer, wgpu::IndexFormat::Uint32);
+    pass.SetVertexBuffer(0, m_vertexBuffer);
+
+    if (m_multiDraw) {
+      pass.MultiDrawIndexedIndirect(m_drawBuffer, 0, m_drawCount,
+                                    m_drawCountBuffer, 0);
+      return;
+    }
+
+    // The CPU knows how many face ranges have quads, not which records the
+    // cull pass wrote them to, so every possible record is drawn.
+    for (uint32_t i = 0; i < m_drawCount; i++) {
+      pass.DrawIndexedIndirect(m_drawBuffer,
+                               i * sizeof(DrawIndexedIndirectArgs));
+    }
+  }
+
+  // CPU fallback of the cull pass, collects the chunk faces to draw front
+  // to back, only the visible ones when culling.
+  void CollectVisible() {
+    m_visibleFaces.clear();
+
+    for (ChunkRenderData *data : m_drawOrder) {
+      if (m_culling &&
+          (!m_bounds.IsVisible(data->slot) || !IsReachable(data->slot))) {
+        continue;
+      }
+
+      for (int face = 0; face < FACE_COUNT; face++) {
+        if (data->faceQuads[face] > 0 &&
+            (!m_culling || FacesCamera(*data, face))) {
+          m_visibleFaces.push_back({data, face});
+        }
+      }
+    }
+  }
+
+  // Draws the faces from CollectVisible directly, for pipelines other than
+  // the one the bundles were recorded with.
+  void DrawVisible(wgpu::RenderPassEncoder &pass,
+                   wgpu::RenderPipeline &pipeline) {
+    if (m_visibleFaces.empty()) {
+      return;
+    }
+
+    pass.SetPipeline(pipeline);
+    pass.SetBindGroup(0, m_bindGroup);
+    pass.SetIndexBuffer(m_indexBuffer, wgpu::IndexFormat::Uint32);
+    pass.SetVertexBuffer(0, m_vertexBuffer);
+
+    for (const ChunkFace &visible : m_visibleFaces) {
+      const ChunkRenderData &data = *visible.data;
+      uint32_t firstQuad = GetFirstQuad(data, visible.face);
+
+      pass.DrawIndexed(data.faceQuads[visible.face] * 6, 1, 0,
+                       data.firstVertex + firstQuad * 4, data.slot);
+    }
+  }
+
+  void DrawTerrain(wgpu::RenderPassEncoder &pass,
+                   wgpu::RenderPipeline &pipeline) {
+    if (m_indirect) {
+      DrawIndirect(pass, pipeline);
+    } else {
+      DrawVisible(pass, pipeline);
+    }
+  }
+
   virtual void Render() override {
     wgpu::Device &device = GetDevice();
     wgpu::Surface &surface = GetSurface();
 
+    // The camera has to land this frame, so it skips the uploader.
     device.GetQueue().WriteBuffer(m_uniformBuffer, 0, &m_uniformData,
                                   sizeof(m_uniformData));
+    device.GetQueue().WriteBuffer(m_reachableBuffer, 0, m_reachable.data(),
+                                  m_reachable.size() * sizeof(uint32_t));
+    device.GetQueue().WriteBuffer(m_orderBuffer, 0, m_orderSlots.data(),
+                                  m_orderSlots.size() * sizeof(uint32_t));
 
     wgpu::SurfaceTexture surfaceTexture;
     surface.GetCurrentTexture(&surfaceTexture);
 
     wgpu::RenderPassColorAttachment attachment = {
-        .view = surfaceTexture.texture.CreateView(),
+        .view = m_resolution.GetView(),
         .loadOp = wgpu::LoadOp::Clear,
         .storeOp = wgpu::StoreOp::Store,
         .clearValue =
@@ -242,36 +1057,114 @@ public:
         .stencilReadOnly = true,
     };
 
+    // GPU time is measured from the first scene pass to the end of the
+    // upscale, see DynamicResolution.
+    bool timing = m_resolution.Begin();
+
     wgpu::RenderPassDescriptor renderPassDesc = {
         .colorAttachmentCount = 1,
         .colorAttachments = &attachment,
         .depthStencilAttachment = &depthStencilAttachment,
+        .occlusionQuerySet = nullptr,
+        .timestampWrites =
+            m_prepass ? nullptr : m_resolution.GetTimestampWrites(),
     };
 
+    // Skipped while every readback buffer is still waiting for results.
+    bool querying = !m_queried.empty() && m_queries.Begin();
+    if (querying) {
+      renderPassDesc.occlusionQuerySet = m_queries.GetQuerySet();
+    }
+
     wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+
+    // Level 0 of the block textures goes through the uploader, which has
+    // submitted everything it staged by now.
+    if (m_texture.NeedsMips()) {
+      m_texture.GenerateMips(GetUploader(), encoder);
+    }
+
+    if (m_indirect) {
+      EncodeCull(encoder);
+    } else {
+      CollectVisible();
+    }
+
+    // The prepass lays down the terrain's depth, so the color pass shades
+    // every visible fragment exactly once.
+    if (m_prepass) {
+      wgpu::RenderPassDescriptor prepassDesc = {
+          .colorAttachmentCount = 0,
+          .colorAttachments = nullptr,
+          .depthStencilAttachment = &depthStencilAttachment,
+          .occlusionQuerySet = nullptr,
+          .timestampWrites = m_resolution.GetTimestampWrites(),
+      };
+
+      wgpu::RenderPassEncoder prepass = encoder.BeginRenderPass(&prepassDesc);
+      DrawTerrain(prepass, m_pipeline.GetPrepassPipeline());
+      prepass.End();
+
+      depthStencilAttachment.depthLoadOp = wgpu::LoadOp::Load;
+    }
+
     wgpu::RenderPassEncoder pass = encoder.BeginRenderPass(&renderPassDesc);
 
-    pass.SetPipeline(m_pipeline.GetPipeline());
-    pass.SetVertexBuffer(0, m_vertexBuffer);
+    if (m_prepass) {
+      DrawTerrain(pass, m_pipeline.GetEqualPipeline());
+    } else if (m_indirect) {
+      DrawIndirect(pass, m_pipeline.GetPipeline());
+    } else {
+      // Replays the prerecorded bundles of the visible faces.
+      m_visibleBundles.clear();
 
-    for (int x = 0; x < WORLD_SIZE; x++) {
-      for (int y = 0; y < WORLD_SIZE; y++) {
-        for (int z = 0; z < WORLD_SIZE; z++) {
-          if (m_world[x][y][z]) {
-            uint32_t offset = GetBlockIdx(x, y, z) * GetSSBOElementSize();
+      for (const ChunkFace &visible : m_visibleFaces) {
+        m_visibleBundles.push_back(visible.data->bundles[visible.face]);
+      }
 
-            pass.SetBindGroup(0, m_bindGroup, 1, &offset);
+      pass.ExecuteBundles(m_visibleBundles.size(), m_visibleBundles.data());
+    }
 
-            pass.Draw(6 * 6);
-          }
-        }
+    // Tested against the depth of the chunks drawn above, occluded chunks
+    // are queried too so they reappear once any of their box is visible.
+    if (querying) {
+      pass.SetPipeline(m_queries.GetPipeline());
+      pass.SetBindGroup(0, m_bindGroup);
+
+      for (uint32_t slot : m_queried) {
+        m_queries.Issue(pass, slot);
       }
     }
 
     pass.End();
 
+    if (querying) {
+      m_queries.Resolve(encoder);
+    }
+
+    // Only the indirect path reads the pyramid, so it is only kept up to
+    // date there.
+    m_hizBuilt = m_indirect && m_occlusion;
+    if (m_hizBuilt) {
+      m_hiz.Build(encoder);
+    }
+
+    m_resolution.Blit(encoder, surfaceTexture.texture.CreateView());
+
+    if (timing) {
+      m_resolution.Resolve(encoder);
+    }
+
     wgpu::CommandBuffer commands = encoder.Finish();
     device.GetQueue().Submit(1, &commands);
+
+    if (querying) {
+      m_queries.Read();
+    }
+
+    if (timing) {
+      m_resolution.Read();
+    }
   }
 
   glm::quat GetRotation() {
@@ -320,9 +1213,8 @@ public:
     float currentDistance = 0.0f;
 
     while (currentDistance < maxDistance) {
-      if (voxel.x >= 0 && voxel.x < WORLD_SIZE && voxel.y >= 0 &&
-          voxel.y < WORLD_SIZE && voxel.z >= 0 && voxel.z < WORLD_SIZE) {
-        if (m_world[voxel.x][voxel.y][voxel.z]) {
+      if (m_world.IsLoaded(voxel)) {
+        if (m_world.GetBlock(voxel) != BLOCK_AIR) {
           glm::ivec3 adjacent = voxel - normal;
           return RayHit{voxel, adjacent};
         }
@@ -363,6 +1255,20 @@ public:
   virtual void Update(float deltaTime) override {
     auto &window = GetWindow();
 
+    // Applies the scale picked from the last measured frames before
+    // anything below reads the size of the pyramid.
+    if (m_resolution.Update(GetDevice())) {
+      ResizeTargets();
+    }
+
+    // The pyramid was built from last frame's depth, so the cull pass
+    // projects chunks with last frame's matrices. The test is skipped when
+    // there is no pyramid of last frame.
+    m_uniformData.hizViewProj = m_uniformData.proj * m_uniformData.view;
+    m_uniformData.hiz =
+        glm::uvec4(m_occlusion && m_hizBuilt, m_hiz.GetMipCount(),
+                   m_hiz.GetWidth(), m_hiz.GetHeight());
+
     glm::mat4 invPV = glm::inverse(m_uniformData.proj * GetView());
     glm::vec4 worldPos = invPV * glm::vec4(0.5f, 0.5f, 0.0f, 1.0f);
     glm::vec3 origin = glm::vec3(worldPos) / worldPos.w;
@@ -376,7 +1282,7 @@ public:
       if (hit.has_value() &&
           glm::distance(cast.origin, glm::vec3(hit.value().hit)) <= 5.0f) {
         RayHit value = hit.value();
-        m_world[value.hit.x][value.hit.y][value.hit.z] = 0;
+        m_world.SetBlock(value.hit, BLOCK_AIR);
       }
     }
 
@@ -389,10 +1295,81 @@ public:
       if (hit.has_value() &&
           glm::distance(cast.origin, glm::vec3(hit.value().hit)) <= 5.0f) {
         RayHit value = hit.value();
-        m_world[value.adj.x][value.adj.y][value.adj.z] = 1;
+        m_world.SetBlock(value.adj, BLOCK_COBBLESTONE);
+      }
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_G)) {
+      static const char *modeNames[] = {"culled", "greedy", "binary"};
+
+      MeshingMode mode = MeshingMode((m_mesher.GetMode() + 1) % 3);
+      m_mesher.SetMode(mode);
+
+      for (auto &[key, chunk] : m_world.GetChunks()) {
+        chunk->SetDirty(true);
+      }
+
+      LOG_INFO(Default, "Meshing mode: {}", modeNames[mode]);
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_I)) {
+      if (GetDevice().HasFeature(wgpu::FeatureName::IndirectFirstInstance)) {
+        m_indirect = !m_indirect;
+        LOG_INFO(Default, "Chunk drawing: {}",
+                 m_indirect ? "indirect" : "bundles");
+      } else {
+        LOG_WARN(Default, "GPU-driven drawing needs IndirectFirstInstance");
       }
     }
 
+    if (window.IsKeyJustPressed(GLFW_KEY_H)) {
+      m_occlusion = !m_occlusion;
+      LOG_INFO(Default, "Hi-Z occlusion culling: {}",
+               m_occlusion ? "on" : "off");
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_O)) {
+      m_queryCulling = !m_queryCulling;
+      LOG_INFO(Default, "Occlusion query culling: {}",
+               m_queryCulling ? "on" : "off");
+
+      // Results from before the toggle may be stale by now.
+      for (auto &[key, data] : m_chunkData) {
+        m_queries.Invalidate(data.slot);
+      }
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_R)) {
+      m_rasterCulling = !m_rasterCulling;
+      LOG_INFO(Default, "Software occlusion culling: {}",
+               m_rasterCulling ? "on" : "off");
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_P)) {
+      m_prepass = !m_prepass;
+      LOG_INFO(Default, "Depth prepass: {}", m_prepass ? "on" : "off");
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_F)) {
+      if (m_resolution.IsSupported()) {
+        m_resolution.SetEnabled(!m_resolution.IsEnabled());
+        LOG_INFO(Default, "Dynamic resolution: {}",
+                 m_resolution.IsEnabled() ? "on" : "off");
+      } else {
+        LOG_WARN(Default, "Dynamic resolution needs TimestampQuery");
+      }
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_V)) {
+      m_caveCulling = !m_caveCulling;
+      LOG_INFO(Default, "Cave culling: {}", m_caveCulling ? "on" : "off");
+    }
+
+    if (window.IsKeyJustPressed(GLFW_KEY_C)) {
+      m_culling = !m_culling;
+      LOG_INFO(Default, "Frustum culling: {}", m_culling ? "on" : "off");
+    }
+
     auto delta = window.GetCursorDelta();
 
     m_yaw -= delta.x * m_sensitivity * deltaTime;
@@ -455,7 +1432,24 @@ public:
 
     m_cameraPos += movement * m_speed * deltaTime;
 
+    m_world.Update(m_cameraPos);
+
     m_uniformData.view = GetView();
+    m_uniformData.camera = glm::vec4(m_cameraPos, 1.0f);
+
+    // Both cull paths read the frustum from the uniform data.
+    m_uniformData.frustum =
+        m_culling ? Frustum::FromMatrix(m_uniformData.proj * m_uniformData.view)
+                  : Frustum::Infinite();
+
+    // Runs before the uploader submits, so new meshes are drawn this frame.
+    SyncChunks();
+    SortChunks();
+    UpdateReachable();
+
+    m_bounds.Cull(m_uniformData.frustum);
+    UpdateRasterOcclusion();
+    UpdateOcclusion();
   }
 
   virtual void Destroy() override {
@@ -463,26 +1457,125 @@ public:
 
     m_texture.Release();
 
+    m_cullBindGroup = nullptr;
+    m_cullPipeline.Release();
+    m_hiz.Release();
+    m_queries.Release();
+    m_rasterizer.Release();
+
+    m_visibleBundles.clear();
+    m_visibleFaces.clear();
+    m_chunkData.clear();
+    m_freeSlots.clear();
+    m_bounds.Release();
+    m_walk.clear();
+    m_queried.clear();
+    m_rasterChunks.clear();
+    m_reachable.clear();
+    m_reachableBuffer = nullptr;
+    m_sortChunks.clear();
+    m_drawOrder.clear();
+    m_orderSlots.clear();
+    m_orderBuffer = nullptr;
+    m_world.Release();
+
+    m_vertexAllocator.Release();
+    m_vertexBuffer = nullptr;
+    m_drawBuffer = nullptr;
+    m_drawCountBuffer = nullptr;
+
     m_ssbo = nullptr;
     m_uniformBuffer = nullptr;
-    m_vertexBuffer = nullptr;
+    m_indexBuffer = nullptr;
 
+    m_resolution.Release();
     m_pipeline.Release();
+
+    m_assets.Close();
   }
 
 private:
+  AssetArchive m_assets;
+
   RenderPipeline m_pipeline;
+  DynamicResolution m_resolution;
 
+  ComputePipeline m_cullPipeline;
+
+  // Shared by all chunk meshes, see ChunkRenderData.
   wgpu::Buffer m_vertexBuffer;
+  RangeAllocator m_vertexAllocator;
+  wgpu::Buffer m_indexBuffer;
+  uint32_t m_indexCapacity = 0;
+
+  // Indirect draw records written by the cull pass and their count.
+  wgpu::Buffer m_drawBuffer;
+  wgpu::Buffer m_drawCountBuffer;
+  wgpu::BindGroup m_cullBindGroup;
+  uint32_t m_drawCount = 0;
+  bool m_indirect = false;
+  bool m_multiDraw = false;
+  bool m_culling = true;
+  bool m_prepass = false;
+
+  DepthPyramid m_hiz;
+  bool m_occlusion = true;
+  bool m_hizBuilt = false;
+
+  OcclusionQueries m_queries;
+  // Slots whose boxes are queried this frame, see UpdateOcclusion.
+  std::vector<uint32_t> m_queried;
+  bool m_queryCulling = false;
+
+  OcclusionRasterizer m_rasterizer;
+  // Chunks tested by UpdateRasterOcclusion, nearest first up to the ones
+  // drawn as occluders.
+  std::vector<ChunkRenderData *> m_rasterChunks;
+  bool m_rasterCulling = true;
+
   wgpu::Buffer m_uniformBuffer;
   wgpu::Buffer m_ssbo;
 
   Texture m_texture;
+  // Block texture levels from PrepareTextures, layer after layer, pointing
+  // into the archive when cooked or into m_decodedTextures otherwise.
+  std::vector<const uint8_t *> m_textureLevels;
+  std::vector<std::vector<uint8_t>> m_decodedTextures;
+  uint32_t m_textureWidth = 0;
+  uint32_t m_textureHeight = 0;
+  bool m_textureCooked = false;
 
   wgpu::BindGroup m_bindGroup;
   UniformData m_uniformData;
 
-  bool m_world[WORLD_SIZE][WORLD_SIZE][WORLD_SIZE];
+  World m_world;
+
+  std::unordered_map<uint64_t, ChunkRenderData> m_chunkData;
+  std::vector<wgpu::RenderBundle> m_visibleBundles;
+  std::vector<ChunkFace> m_visibleFaces;
+  bool m_bundlesDirty = false;
+  std::vector<uint32_t> m_freeSlots;
+  ChunkBounds m_bounds;
+
+  // Chunk slots reachable from the camera, see UpdateReachable, minus the
+  // ones found occluded by UpdateRasterOcclusion and UpdateOcclusion.
+  std::vector<uint32_t> m_reachable;
+  wgpu::Buffer m_reachableBuffer;
+
+  // Chunks with a mesh nearest first, and their slots padded with kNoSlot
+  // for the cull pass, see SortChunks.
+  std::vector<ChunkRenderData *> m_drawOrder;
+  std::vector<uint32_t> m_orderSlots;
+  wgpu::Buffer m_orderBuffer;
+  std::vector<ChunkRenderData *> m_sortChunks;
+  std::vector<uint32_t> m_sortKeys;
+  std::vector<uint32_t> m_sortScratch;
+  std::vector<ChunkWalkStep> m_walk;
+  uint32_t m_walkId = 0;
+  bool m_caveCulling = true;
+
+  Mesher m_mesher;
+  ChunkMesh m_mesh;
 
   glm::vec3 m_cameraPos = {0.0f, 0.0f, 0.0f};
   float m_yaw, m_pitch;
@@ -496,6 +1589,8 @@ std::unique_ptr<Application> CreateApplication() {
   config.SetWidth(1280);
   config.SetHeight(720);
   config.SetTitle("Block Game");
+  config.SetDepthPrepass(false);
+  config.SetTargetFrameTime(1000.0f / 60.0f);
 
   return std::make_unique<BlockGameApplication>();
 }
@@ -0,0 +1,766 @@
+#include "mesher.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+struct FaceDesc {
+	glm::ivec3 normal;
+	glm::ivec3 corners[4];
+};
+
+// Corners are listed counter-clockwise as seen from outside the block,
+// starting at the corner mapped to uv (0, 0) and continuing through
+// (1, 0), (1, 1) and (0, 1).
+// clang-format off
+static const FaceDesc faces[FACE_COUNT] = {
+	// FACE_POS_X
+	{ { 1, 0, 0 }, { { 1, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 } } },
+	// FACE_NEG_X
+	{ { -1, 0, 0 }, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } } },
+	// FACE_POS_Y
+	{ { 0, 1, 0 }, { { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 }, { 0, 1, 0 } } },
+	// FACE_NEG_Y
+	{ { 0, -1, 0 }, { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } } },
+	// FACE_POS_Z
+	{ { 0, 0, 1 }, { { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } } },
+	// FACE_NEG_Z
+	{ { 0, 0, -1 }, { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } } },
+};
+// clang-format on
+
+static const glm::ivec2 cornerUVs[4] = {
+	{ 0, 0 },
+	{ 1, 0 },
+	{ 1, 1 },
+	{ 0, 1 },
+};
+
+struct FaceAxes {
+	int normal;
+	int u, v;
+	int uSign, vSign;
+};
+
+static int GetAxis(glm::ivec3 dir)
+{
+	return dir.x != 0 ? 0 : (dir.y != 0 ? 1 : 2);
+}
+
+// Derives the axes a face's texture runs along from its corner table, so
+// greedy quads keep the same UV orientation as single block faces.
+static FaceAxes GetFaceAxes(Face face)
+{
+	const FaceDesc &desc = faces[face];
+
+	glm::ivec3 u = desc.corners[1] - desc.corners[0];
+	glm::ivec3 v = desc.corners[3] - desc.corners[0];
+
+	FaceAxes axes;
+	axes.normal = GetAxis(desc.normal);
+	axes.u = GetAxis(u);
+	axes.v = GetAxis(v);
+	axes.uSign = u[axes.u];
+	axes.vSign = v[axes.v];
+	return axes;
+}
+
+static inline int CountTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward64(&idx, value);
+	return idx;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+template <int J, uint32_t Mask> static inline void TransposeStage(uint32_t rows[32])
+{
+	for (int base = 0; base < 32; base += 2 * J) {
+		for (int k = base; k < base + J; k++) {
+			uint32_t t = ((rows[k] >> J) ^ rows[k + J]) & Mask;
+			rows[k + J] ^= t;
+			rows[k] ^= (t << J);
+		}
+	}
+}
+
+// Transposes a 32x32 bit matrix in place, so that bit j of row i ends up
+// as bit i of row j.
+static void Transpose32(uint32_t rows[32])
+{
+	TransposeStage<16, 0x0000FFFF>(rows);
+	TransposeStage<8, 0x00FF00FF>(rows);
+	TransposeStage<4, 0x0F0F0F0F>(rows);
+	TransposeStage<2, 0x33333333>(rows);
+	TransposeStage<1, 0x55555555>(rows);
+}
+
+Mesher::Mesher()
+	: m_padded(PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE)
+	, m_mask(CHUNK_SIZE * CHUNK_SIZE)
+	, m_columns(3 * PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE)
+	, m_air(CHUNK_SIZE * CHUNK_SIZE)
+	, m_region(CHUNK_SIZE * CHUNK_SIZE)
+{
+	std::fill(std::begin(m_typeSlots), std::end(m_typeSlots), -1);
+}
+
+void Mesher::Gather(const World &world, const Chunk &chunk)
+{
+	glm::ivec3 origin = chunk.GetOrigin();
+
+	for (int x = 0; x < PADDED_CHUNK_SIZE; x++) {
+		for (int y = 0; y < PADDED_CHUNK_SIZE; y++) {
+			for (int z = 0; z < PADDED_CHUNK_SIZE; z++) {
+				bool inside = x > 0 && x <= CHUNK_SIZE &&
+					      y > 0 && y <= CHUNK_SIZE &&
+					      z > 0 && z <= CHUNK_SIZE;
+
+				Block block;
+				if (inside) {
+					block = chunk.GetBlock(x - 1, y - 1,
+							       z - 1);
+				} else {
+					block = world.GetBlock(
+						origin +
+						glm::ivec3(x - 1, y - 1, z - 1));
+				}
+
+				m_padded[GetPaddedIdx(x, y, z)] = block;
+			}
+		}
+	}
+}
+
+void Mesher::EmitQuad(ChunkMesh &mesh, Face face, Block type, glm::ivec3 pos)
+{
+	const FaceDesc &desc = faces[face];
+
+	for (int i = 0; i < 4; i++) {
+		mesh.vertices.push_back(ChunkVertex::Pack(
+			pos + desc.corners[i], face, cornerUVs[i], type));
+	}
+}
+
+void Mesher::EmitQuad(ChunkMesh &mesh, Face face, Block type, int slice,
+		      int u, int v, int width, int height)
+{
+	const FaceDesc &desc = faces[face];
+	FaceAxes axes = GetFaceAxes(face);
+
+	for (int i = 0; i < 4; i++) {
+		glm::ivec2 uv = cornerUVs[i];
+
+		glm::ivec3 corner(0);
+		corner[axes.normal] = slice + (desc.normal[axes.normal] > 0);
+		corner[axes.u] = axes.uSign > 0 ? u + uv.x * width :
+						  u + width - uv.x * width;
+		corner[axes.v] = axes.vSign > 0 ? v + uv.y * height :
+						  v + height - uv.y * height;
+
+		mesh.vertices.push_back(ChunkVertex::Pack(
+			corner, face, uv * glm::ivec2(width, height), type));
+	}
+}
+
+void Mesher::Mesh(const World &world, const Chunk &chunk, ChunkMesh &mesh)
+{
+	mesh.Clear();
+
+	if (chunk.IsEmpty()) {
+		mesh.visibility = VISIBILITY_ALL;
+		return;
+	}
+
+	switch (m_mode) {
+	case MESHING_CULLED:
+		Gather(world, chunk);
+		MeshCulled(chunk, mesh);
+		break;
+	case MESHING_GREEDY:
+		Gather(world, chunk);
+		MeshGreedy(mesh);
+		break;
+	case MESHING_BINARY:
+		MeshBinary(world, chunk, mesh);
+		break;
+	}
+
+	SortByFace(mesh);
+	BuildVisibility(chunk, mesh);
+}
+
+void Mesher::SortByFace(ChunkMesh &mesh)
+{
+	uint32_t quadCount = mesh.GetQuadCount();
+
+	for (uint32_t quad = 0; quad < quadCount; quad++) {
+		mesh.faceQuads[(mesh.vertices[quad * 4].position >> 18) & 7]++;
+	}
+
+	uint32_t next[FACE_COUNT];
+	uint32_t first = 0;
+	for (int face = 0; face < FACE_COUNT; face++) {
+		next[face] = first;
+		first += mesh.faceQuads[face];
+	}
+
+	m_sorted.resize(mesh.vertices.size());
+
+	for (uint32_t quad = 0; quad < quadCount; quad++) {
+		const ChunkVertex *src = &mesh.vertices[quad * 4];
+		uint32_t dst = next[(src->position >> 18) & 7]++;
+
+		std::copy(src, src + 4, &m_sorted[dst * 4]);
+	}
+
+	mesh.vertices.swap(m_sorted);
+}
+
+glm::ivec3 Mesher::GetFaceNormal(Face face)
+{
+	return faces[face].normal;
+}
+
+static const uint32_t kColumnMask =
+	CHUNK_SIZE == 32 ? ~0u : (1u << CHUNK_SIZE) - 1;
+
+// Extends the set bits along the runs of air they are in.
+static inline uint32_t FillRuns(uint32_t bits, uint32_t air)
+{
+	uint32_t filled;
+	do {
+		filled = bits;
+		bits |= ((bits << 1) | (bits >> 1)) & air;
+	} while (bits != filled);
+
+	return bits;
+}
+
+void Mesher::BuildVisibility(const Chunk &chunk, ChunkMesh &mesh)
+{
+	const int last = CHUNK_SIZE - 1;
+
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			m_air[x * CHUNK_SIZE + z] =
+				~chunk.GetColumn(x, z) & kColumnMask;
+		}
+	}
+
+	std::fill(m_region.begin(), m_region.end(), 0);
+
+	// Regions that touch no face do not connect anything, so only air on
+	// the chunk border seeds regions.
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			bool side = x == 0 || x == last || z == 0 || z == last;
+			uint32_t border = side ? kColumnMask : 1u | (1u << last);
+
+			int c = x * CHUNK_SIZE + z;
+
+			while ((m_air[c] & border) != 0 &&
+			       mesh.visibility != VISIBILITY_ALL) {
+				uint32_t seed = m_air[c] & border;
+				m_region[c] = FillRuns(seed & -seed, m_air[c]);
+
+				m_regionMin = { x, z };
+				m_regionMax = { x, z };
+
+				// Alternating directions lets a sweep carry the
+				// region across the chunk either way.
+				for (int pass = 0; GrowRegion(pass & 1); pass++) {
+				}
+
+				AddRegion(mesh);
+			}
+		}
+	}
+}
+
+bool Mesher::GrowRegion(bool backward)
+{
+	// Only columns within the region's bounds or next to them can change.
+	// The loop conditions read the bounds again as the sweep goes, so a
+	// sweep can carry the region to the far side of the chunk in one go.
+	const int last = CHUNK_SIZE - 1;
+	bool changed = false;
+
+	if (backward) {
+		for (int x = std::min(m_regionMax.x + 1, last);
+		     x >= std::max(m_regionMin.x - 1, 0); x--) {
+			for (int z = std::min(m_regionMax.y + 1, last);
+			     z >= std::max(m_regionMin.y - 1, 0); z--) {
+				changed |= GrowColumn(x, z);
+			}
+		}
+	} else {
+		for (int x = std::max(m_regionMin.x - 1, 0);
+		     x <= std::min(m_regionMax.x + 1, last); x++) {
+			for (int z = std::max(m_regionMin.y - 1, 0);
+			     z <= std::min(m_regionMax.y + 1, last); z++) {
+				changed |= GrowColumn(x, z);
+			}
+		}
+	}
+
+	return changed;
+}
+
+bool Mesher::GrowColumn(int x, int z)
+{
+	int c = x * CHUNK_SIZE + z;
+
+	uint32_t grown = m_region[c];
+
+	if (x > 0) {
+		grown |= m_region[c - CHUNK_SIZE];
+	}
+	if (x < CHUNK_SIZE - 1) {
+		grown |= m_region[c + CHUNK_SIZE];
+	}
+	if (z > 0) {
+		grown |= m_region[c - 1];
+	}
+	if (z < CHUNK_SIZE - 1) {
+		grown |= m_region[c + 1];
+	}
+
+	uint32_t air = m_air[c];
+	grown &= air;
+
+	if (grown == m_region[c]) {
+		return false;
+	}
+
+	m_region[c] = FillRuns(grown, air);
+	m_regionMin = glm::min(m_regionMin, glm::ivec2(x, z));
+	m_regionMax = glm::max(m_regionMax, glm::ivec2(x, z));
+
+	return true;
+}
+
+void Mesher::AddRegion(ChunkMesh &mesh)
+{
+	const int last = CHUNK_SIZE - 1;
+
+	uint32_t touched = 0;
+	uint32_t columns = 0;
+
+	for (int x = m_regionMin.x; x <= m_regionMax.x; x++) {
+		for (int z = m_regionMin.y; z <= m_regionMax.y; z++) {
+			int c = x * CHUNK_SIZE + z;
+
+			uint32_t column = m_region[c];
+			if (column == 0) {
+				continue;
+			}
+
+			touched |= (x == last) << FACE_POS_X;
+			touched |= (x == 0) << FACE_NEG_X;
+			touched |= (z == last) << FACE_POS_Z;
+			touched |= (z == 0) << FACE_NEG_Z;
+			columns |= column;
+
+			// The region's air is done with.
+			m_air[c] &= ~column;
+			m_region[c] = 0;
+		}
+	}
+
+	touched |= (columns >> last) << FACE_POS_Y;
+	touched |= (columns & 1) << FACE_NEG_Y;
+
+	for (int face = 0; face < FACE_COUNT; face++) {
+		if (touched & (1u << face)) {
+			mesh.visibility |= uint64_t(touched) << (face * FACE_COUNT);
+		}
+	}
+}
+
+void Mesher::MeshCulled(const Chunk &chunk, ChunkMesh &mesh)
+{
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				Block block = chunk.GetBlock(x, y, z);
+				if (block == BLOCK_AIR) {
+					continue;
+				}
+
+				for (int face = 0; face < FACE_COUNT; face++) {
+					glm::ivec3 n = glm::ivec3(x, y, z) +
+						       faces[face].normal;
+
+					if (GetPadded(n) == BLOCK_AIR) {
+						EmitQuad(mesh, Face(face), block,
+							 { x, y, z });
+					}
+				}
+			}
+		}
+	}
+}
+
+void Mesher::BuildMask(Face face, int slice)
+{
+	const FaceDesc &desc = faces[face];
+	FaceAxes axes = GetFaceAxes(face);
+
+	for (int v = 0; v < CHUNK_SIZE; v++) {
+		for (int u = 0; u < CHUNK_SIZE; u++) {
+			glm::ivec3 pos;
+			pos[axes.normal] = slice;
+			pos[axes.u] = u;
+			pos[axes.v] = v;
+
+			Block block = GetPadded(pos);
+			if (GetPadded(pos + desc.normal) != BLOCK_AIR) {
+				block = BLOCK_AIR;
+			}
+
+			m_mask[v * CHUNK_SIZE + u] = block;
+		}
+	}
+}
+
+void Mesher::MergeMask(ChunkMesh &mesh, Face face, int slice)
+{
+	for (int v = 0; v < CHUNK_SIZE; v++) {
+		for (int u = 0; u < CHUNK_SIZE;) {
+			Block *start = &m_mask[v * CHUNK_SIZE + u];
+			Block block = *start;
+
+			if (block == BLOCK_AIR) {
+				u++;
+				continue;
+			}
+
+			int width = 1;
+			while (u + width < CHUNK_SIZE && start[width] == block) {
+				width++;
+			}
+
+			auto rowMatches = [&](int row) {
+				Block *first = start + row * CHUNK_SIZE;
+				return std::all_of(first, first + width,
+						   [block](Block b) {
+							   return b == block;
+						   });
+			};
+
+			int height = 1;
+			while (v + height < CHUNK_SIZE && rowMatches(height)) {
+				height++;
+			}
+
+			for (int row = 0; row < height; row++) {
+				Block *first = start + row * CHUNK_SIZE;
+				std::fill(first, first + width, BLOCK_AIR);
+			}
+
+			EmitQuad(mesh, face, block, slice, u, v, width, height);
+
+			u += width;
+		}
+	}
+}
+
+void Mesher::MeshGreedy(ChunkMesh &mesh)
+{
+	for (int face = 0; face < FACE_COUNT; face++) {
+		for (int slice = 0; slice < CHUNK_SIZE; slice++) {
+			BuildMask(Face(face), slice);
+			MergeMask(mesh, Face(face), slice);
+		}
+	}
+}
+
+void Mesher::BuildColumns(const World &world, const Chunk &chunk)
+{
+	const int last = PADDED_CHUNK_SIZE - 1;
+
+	uint32_t rows[32];
+
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			rows[z] = chunk.GetColumn(x, z);
+			GetColumn(1, x + 1, z + 1) = uint64_t(rows[z]) << 1;
+		}
+
+		Transpose32(rows);
+
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			GetColumn(2, x + 1, y + 1) = uint64_t(rows[y]) << 1;
+		}
+	}
+
+	for (int z = 0; z < CHUNK_SIZE; z++) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			rows[x] = chunk.GetColumn(x, z);
+		}
+
+		Transpose32(rows);
+
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			GetColumn(0, y + 1, z + 1) = uint64_t(rows[y]) << 1;
+		}
+	}
+
+	// Only the column running into a neighbour needs its border bit, the
+	// other padded cells are never looked at when finding faces.
+	glm::ivec3 coord = chunk.GetCoord();
+
+	if (const Chunk *n = world.GetChunk(coord + glm::ivec3(1, 0, 0))) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (uint64_t bits = n->GetColumn(0, z); bits;
+			     bits &= bits - 1) {
+				int y = CountTrailingZeros(bits);
+				GetColumn(0, y + 1, z + 1) |= 1ull << last;
+			}
+		}
+	}
+
+	if (const Chunk *n = world.GetChunk(coord + glm::ivec3(-1, 0, 0))) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			for (uint64_t bits = n->GetColumn(CHUNK_SIZE - 1, z);
+			     bits; bits &= bits - 1) {
+				int y = CountTrailingZeros(bits);
+				GetColumn(0, y + 1, z + 1) |= 1;
+			}
+		}
+	}
+
+	const Chunk *above = world.GetChunk(coord + glm::ivec3(0, 1, 0));
+	const Chunk *below = world.GetChunk(coord + glm::ivec3(0, -1, 0));
+
+	for (int x = 0; x < CHUNK_SIZE && (above || below); x++) {
+		for (int z = 0; z < CHUNK_SIZE; z++) {
+			uint64_t &column = GetColumn(1, x + 1, z + 1);
+
+			if (above) {
+				column |= uint64_t(above->GetColumn(x, z) & 1)
+					  << last;
+			}
+
+			if (below) {
+				column |= below->GetColumn(x, z) >>
+					  (CHUNK_SIZE - 1);
+			}
+		}
+	}
+
+	if (const Chunk *n = world.GetChunk(coord + glm::ivec3(0, 0, 1))) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (uint64_t bits = n->GetColumn(x, 0); bits;
+			     bits &= bits - 1) {
+				int y = CountTrailingZeros(bits);
+				GetColumn(2, x + 1, y + 1) |= 1ull << last;
+			}
+		}
+	}
+
+	if (const Chunk *n = world.GetChunk(coord + glm::ivec3(0, 0, -1))) {
+		for (int x = 0; x < CHUNK_SIZE; x++) {
+			for (uint64_t bits = n->GetColumn(x, CHUNK_SIZE - 1);
+			     bits; bits &= bits - 1) {
+				int y = CountTrailingZeros(bits);
+				GetColumn(2, x + 1, y + 1) |= 1;
+			}
+		}
+	}
+}
+
+// Scatters a visible face into the plane of its block type, looking the
+// type up per face. Only needed for chunks holding several block types.
+void Mesher::AddFace(const Chunk &chunk, int face, int slice, int a, int b)
+{
+	int axis = face / 2;
+
+	glm::ivec3 pos;
+	pos[axis] = slice;
+	pos[axis == 0 ? 1 : 0] = a;
+	pos[axis == 2 ? 1 : 2] = b;
+
+	Block type = chunk.GetBlock(pos.x, pos.y, pos.z);
+
+	int &slot = m_typeSlots[type];
+	if (slot < 0) {
+		slot = m_slotTypes.size();
+		m_slotTypes.push_back(type);
+		m_planes.resize(m_planes.size() +
+				FACE_COUNT * CHUNK_SIZE * CHUNK_SIZE);
+		m_slices.resize(m_slices.size() + FACE_COUNT);
+	}
+
+	GetPlane(slot, face, slice)[a] |= 1u << b;
+	m_slices[slot * FACE_COUNT + face] |= 1u << slice;
+}
+
+void Mesher::ScatterFaces(const Chunk &chunk, int face, int a,
+			  const uint32_t visible[32])
+{
+	bool uniform = chunk.IsUniform();
+
+	for (int b = 0; b < CHUNK_SIZE; b++) {
+		for (uint32_t bits = visible[b]; bits; bits &= bits - 1) {
+			int slice = CountTrailingZeros(bits);
+
+			if (uniform) {
+				GetPlane(0, face, slice)[a] |= 1u << b;
+				m_slices[face] |= 1u << slice;
+			} else {
+				AddFace(chunk, face, slice, a, b);
+			}
+		}
+	}
+}
+
+void Mesher::BuildPlanes(const Chunk &chunk)
+{
+	const uint64_t interior = (1ull << CHUNK_SIZE) - 1;
+
+	bool uniform = chunk.IsUniform();
+	if (uniform) {
+		m_typeSlots[chunk.GetUniformType()] = 0;
+		m_slotTypes.push_back(chunk.GetUniformType());
+		m_planes.resize(FACE_COUNT * CHUNK_SIZE * CHUNK_SIZE);
+		m_slices.resize(FACE_COUNT);
+	}
+
+	uint32_t visible[2][32];
+
+	for (int axis = 0; axis < 3; axis++) {
+		for (int a = 0; a < CHUNK_SIZE; a++) {
+			int rows[2] = { 0, 0 };
+
+			for (int b = 0; b < CHUNK_SIZE; b++) {
+				uint64_t column = GetColumn(axis, a + 1, b + 1);
+
+				// A face is visible where a solid bit is
+				// followed by an air bit in its direction.
+				visible[0][b] = ((column & ~(column >> 1)) >> 1) &
+						interior;
+				visible[1][b] = ((column & ~(column << 1)) >> 1) &
+						interior;
+
+				rows[0] += visible[0][b] != 0;
+				rows[1] += visible[1][b] != 0;
+			}
+
+			for (int side = 0; side < 2; side++) {
+				int face = axis * 2 + side;
+
+				if (rows[side] == 0) {
+					continue;
+				}
+
+				// A few rows are cheaper to scatter bit by bit
+				// than to transpose.
+				if (!uniform || rows[side] < 8) {
+					ScatterFaces(chunk, face, a, visible[side]);
+					continue;
+				}
+
+				// Rows are indexed by b with bits along the
+				// slice, the planes want the opposite.
+				Transpose32(visible[side]);
+
+				for (int slice = 0; slice < CHUNK_SIZE; slice++) {
+					GetPlane(0, face, slice)[a] =
+						visible[side][slice];
+
+					if (visible[side][slice]) {
+						m_slices[face] |= 1u << slice;
+					}
+				}
+			}
+		}
+	}
+}
+
+void Mesher::MergePlane(ChunkMesh &mesh, Face face, Block type, int slice,
+			uint32_t *plane)
+{
+	int axis = face / 2;
+	bool rowsAlongU = GetFaceAxes(face).u == (axis == 0 ? 1 : 0);
+
+	for (int row = 0; row < CHUNK_SIZE; row++) {
+		uint32_t bits = plane[row];
+
+		while (bits) {
+			int start = CountTrailingZeros(bits);
+			int width = CountTrailingZeros(~(uint64_t(bits) >> start));
+
+			uint32_t mask =
+				uint32_t(((1ull << width) - 1) << start);
+			bits &= ~mask;
+
+			int height = 1;
+			while (row + height < CHUNK_SIZE &&
+			       (plane[row + height] & mask) == mask) {
+				plane[row + height] &= ~mask;
+				height++;
+			}
+
+			if (rowsAlongU) {
+				EmitQuad(mesh, face, type, slice, row, start,
+					 height, width);
+			} else {
+				EmitQuad(mesh, face, type, slice, start, row,
+					 width, height);
+			}
+		}
+
+		plane[row] = 0;
+	}
+}
+
+void Mesher::MeshBinary(const World &world, const Chunk &chunk,
+			ChunkMesh &mesh)
+{
+	BuildColumns(world, chunk);
+	BuildPlanes(chunk);
+
+	for (int slot = 0; slot < int(m_slotTypes.size()); slot++) {
+		for (int face = 0; face < FACE_COUNT; face++) {
+			uint32_t &slices = m_slices[slot * FACE_COUNT + face];
+
+			for (; slices; slices &= slices - 1) {
+				int slice = CountTrailingZeros(slices);
+				MergePlane(mesh, Face(face), m_slotTypes[slot],
+					   slice, GetPlane(slot, face, slice));
+			}
+		}
+
+		m_typeSlots[m_slotTypes[slot]] = -1;
+	}
+
+	m_slotTypes.clear();
+	m_planes.clear();
+	m_slices.clear();
+}
+
+std::vector<uint32_t> Mesher::GetQuadIndices(uint32_t quadCount)
+{
+	std::vector<uint32_t> indices;
+	indices.reserve(quadCount * 6);
+
+	for (uint32_t quad = 0; quad < quadCount; quad++) {
+		uint32_t base = quad * 4;
+
+		indices.push_back(base + 0);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+		indices.push_back(base + 0);
+	}
+
+	return indices;
+}
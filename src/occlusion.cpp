@@ -0,0 +1,191 @@
+#include "occlusion.h"
+
+DEFINE_LOG_CATEGORY(Occlusion);
+
+void OcclusionQueries::Create(wgpu::Device &device, const char *src,
+			      RenderPipeline &pipeline, uint32_t slotCount)
+{
+	Release();
+
+	m_occluded.assign(slotCount, 0);
+	m_generations.assign(slotCount, 0);
+
+	wgpu::ShaderSourceWGSL wgsl({
+		.code = src,
+	});
+
+	wgpu::ShaderModuleDescriptor shaderModuleDesc = {
+		.nextInChain = &wgsl,
+	};
+
+	wgpu::ShaderModule module =
+		device.CreateShaderModule(&shaderModuleDesc);
+
+	// Only the depth test matters, nothing is written.
+	wgpu::ColorTargetState colorTargetState = {
+		.format = pipeline.GetFormat(),
+		.blend = nullptr,
+		.writeMask = wgpu::ColorWriteMask::None,
+	};
+
+	wgpu::FragmentState fragmentState = {
+		.module = module,
+		.entryPoint = "fs_main",
+		.constantCount = 0,
+		.constants = nullptr,
+		.targetCount = 1,
+		.targets = &colorTargetState,
+	};
+
+	wgpu::DepthStencilState depthStencilState = {
+		.format = pipeline.GetDepthStencilFormat(),
+		.depthWriteEnabled = false,
+		.depthCompare = wgpu::CompareFunction::LessEqual,
+		.stencilReadMask = 0,
+		.stencilWriteMask = 0,
+	};
+
+	// The box is generated from the vertex index, see box.wgsl. Both
+	// sides are drawn so boxes the camera is close to still count.
+	wgpu::RenderPipelineDescriptor desc = {
+    .layout = pipeline.GetLayout(),
+		.vertex = {
+      .module = module,
+      .entryPoint = "vs_main",
+      .constantCount = 0,
+      .constants = nullptr,
+      .bufferCount = 0,
+      .buffers = nullptr,
+    },
+		.primitive = {
+      .topology = wgpu::PrimitiveTopology::TriangleList,
+      .stripIndexFormat = wgpu::IndexFormat::Undefined,
+      .frontFace = wgpu::FrontFace::CCW,
+      .cullMode = wgpu::CullMode::None
+    },
+    .depthStencil = &depthStencilState,
+    .multisample = {
+      .count = 1,
+      .mask = ~0u,
+      .alphaToCoverageEnabled = false,
+    },
+    .fragment = &fragmentState,
+	};
+
+	m_futures.push_back(CreatePipelineAsync(device, desc, m_pipeline));
+
+	wgpu::QuerySetDescriptor querySetDesc = {
+		.type = wgpu::QueryType::Occlusion,
+		.count = slotCount,
+	};
+
+	m_querySet = device.CreateQuerySet(&querySetDesc);
+
+	// Every query resolves to a 64-bit sample count.
+	wgpu::BufferDescriptor resolveDesc = {
+		.usage = wgpu::BufferUsage::QueryResolve |
+			 wgpu::BufferUsage::CopySrc,
+		.size = slotCount * sizeof(uint64_t),
+	};
+
+	m_resolveBuffer = device.CreateBuffer(&resolveDesc);
+
+	m_ring.Create(device, kReadbackCount, slotCount * sizeof(uint64_t));
+	m_readbacks.resize(kReadbackCount);
+}
+
+void OcclusionQueries::Wait(wgpu::Instance &instance)
+{
+	WaitForPipelines(instance, m_futures);
+}
+
+void OcclusionQueries::Release()
+{
+	m_futures.clear();
+	m_ring.Release();
+	m_readbacks.clear();
+
+	m_resolveBuffer = nullptr;
+	m_querySet = nullptr;
+	m_pipeline = nullptr;
+
+	m_occluded.clear();
+	m_generations.clear();
+}
+
+bool OcclusionQueries::Begin()
+{
+	if (!m_ring.Begin()) {
+		return false;
+	}
+
+	Readback &readback = m_readbacks[m_ring.GetIndex()];
+	readback.slots.clear();
+	readback.generations.clear();
+	return true;
+}
+
+void OcclusionQueries::Issue(wgpu::RenderPassEncoder &pass, uint32_t slot)
+{
+	Readback &readback = m_readbacks[m_ring.GetIndex()];
+	uint32_t query = readback.slots.size();
+
+	readback.slots.push_back(slot);
+	readback.generations.push_back(m_generations[slot]);
+
+	// The slot is passed as the instance index, as for chunk draws.
+	pass.BeginOcclusionQuery(query);
+	pass.Draw(36, 1, 0, slot);
+	pass.EndOcclusionQuery();
+}
+
+void OcclusionQueries::Resolve(wgpu::CommandEncoder &encoder)
+{
+	uint32_t count = m_readbacks[m_ring.GetIndex()].slots.size();
+	if (count == 0) {
+		return;
+	}
+
+	encoder.ResolveQuerySet(m_querySet, 0, count, m_resolveBuffer, 0);
+	encoder.CopyBufferToBuffer(m_resolveBuffer, 0, m_ring.GetBuffer(), 0,
+				   count * sizeof(uint64_t));
+}
+
+void OcclusionQueries::Read()
+{
+	if (!m_ring.IsActive()) {
+		return;
+	}
+
+	// Not touched again until the read finished, see Begin.
+	const Readback *readback = &m_readbacks[m_ring.GetIndex()];
+
+	m_ring.Read(
+		readback->slots.size() * sizeof(uint64_t),
+		[this, readback](const void *data) {
+			const uint64_t *samples =
+				static_cast<const uint64_t *>(data);
+
+			uint32_t occluded = 0;
+
+			for (size_t i = 0; i < readback->slots.size(); i++) {
+				uint32_t slot = readback->slots[i];
+				if (readback->generations[i] !=
+				    m_generations[slot]) {
+					continue;
+				}
+
+				m_occluded[slot] = samples[i] == 0;
+				occluded += samples[i] == 0;
+			}
+
+			LOG_DEBUG(Occlusion, "{} of {} chunks occluded",
+				  occluded, readback->slots.size());
+		});
+}
+
+void OcclusionQueries::Invalidate(uint32_t slot)
+{
+	m_occluded[slot] = 0;
+	m_generations[slot]++;
+}
@@ -7,9 +7,59 @@
 #include "webgpu/webgpu_cpp.h"
 #include <vector>
 
+DEFINE_LOG_CATEGORY(Pipeline);
+
+wgpu::Future CreatePipelineAsync(wgpu::Device &device,
+				 const wgpu::RenderPipelineDescriptor &desc,
+				 wgpu::RenderPipeline &target)
+{
+	return device.CreateRenderPipelineAsync(
+		&desc, wgpu::CallbackMode::WaitAnyOnly,
+		[&target](wgpu::CreatePipelineAsyncStatus status,
+			  wgpu::RenderPipeline pipeline,
+			  wgpu::StringView message) {
+			LOG_CRITICAL_IF(
+				Pipeline,
+				status != wgpu::CreatePipelineAsyncStatus::Success,
+				"CreateRenderPipelineAsync: {}", message);
+
+			target = std::move(pipeline);
+		});
+}
+
+wgpu::Future CreatePipelineAsync(wgpu::Device &device,
+				 const wgpu::ComputePipelineDescriptor &desc,
+				 wgpu::ComputePipeline &target)
+{
+	return device.CreateComputePipelineAsync(
+		&desc, wgpu::CallbackMode::WaitAnyOnly,
+		[&target](wgpu::CreatePipelineAsyncStatus status,
+			  wgpu::ComputePipeline pipeline,
+			  wgpu::StringView message) {
+			LOG_CRITICAL_IF(
+				Pipeline,
+				status != wgpu::CreatePipelineAsyncStatus::Success,
+				"CreateComputePipelineAsync: {}", message);
+
+			target = std::move(pipeline);
+		});
+}
+
+void WaitForPipelines(wgpu::Instance &instance,
+		      std::vector<wgpu::Future> &futures)
+{
+	for (wgpu::Future &future : futures) {
+		instance.WaitAny(future, UINT64_MAX);
+	}
+
+	futures.clear();
+}
+
 void RenderPipeline::Create(wgpu::Device &device, const char *src,
 			    wgpu::TextureFormat format)
 {
+	m_format = format;
+
 	std::vector<wgpu::BindGroupLayoutEntry> entries = {
     wgpu::BindGroupLayoutEntry {
       .binding = 0,
@@ -24,7 +74,7 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
       .visibility = wgpu::ShaderStage::Vertex,
       .buffer = {
         .type = wgpu::BufferBindingType::ReadOnlyStorage,
-        .hasDynamicOffset = true,
+        .hasDynamicOffset = false,
         .minBindingSize = sizeof(SSBOData),
       },
     },
@@ -33,7 +83,14 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
       .visibility = wgpu::ShaderStage::Fragment,
       .texture = {
         .sampleType = wgpu::TextureSampleType::Float,
-        .viewDimension = wgpu::TextureViewDimension::e2D,
+        .viewDimension = wgpu::TextureViewDimension::e2DArray,
+      },
+    },
+    wgpu::BindGroupLayoutEntry {
+      .binding = 3,
+      .visibility = wgpu::ShaderStage::Fragment,
+      .sampler = {
+        .type = wgpu::SamplerBindingType::Filtering,
       },
     }
   };
@@ -91,28 +148,23 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
 		.targets = &colorTargetState,
 	};
 
-	std::vector<wgpu::VertexAttribute> attributes = {
-		wgpu::VertexAttribute{
-			.format = wgpu::VertexFormat::Float32x4,
-			.offset = 0,
-			.shaderLocation = 0,
-		},
-		wgpu::VertexAttribute{
-			.format = wgpu::VertexFormat::Float32x2,
-			.offset = 4 * sizeof(float),
-			.shaderLocation = 1,
-		}
+	wgpu::VertexAttribute attribute = {
+		.format = wgpu::VertexFormat::Uint32x2,
+		.offset = 0,
+		.shaderLocation = 0,
 	};
 
 	wgpu::VertexBufferLayout vertexBufferLayout = {
 		.stepMode = wgpu::VertexStepMode::Vertex,
-		.arrayStride = 6 * sizeof(float),
-		.attributeCount = attributes.size(),
-		.attributes = attributes.data(),
+		.arrayStride = 2 * sizeof(uint32_t),
+		.attributeCount = 1,
+		.attributes = &attribute,
 	};
 
 	wgpu::TextureFormat depthStencilFormat =
 		wgpu::TextureFormat::Depth24Plus;
+	m_depthStencilFormat = depthStencilFormat;
+
 	wgpu::DepthStencilState depthStencilState = {
 		.format = depthStencilFormat,
 		.depthWriteEnabled = true,
@@ -135,7 +187,7 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
       .topology = wgpu::PrimitiveTopology::TriangleList,
       .stripIndexFormat = wgpu::IndexFormat::Undefined,
       .frontFace = wgpu::FrontFace::CCW,
-      .cullMode = wgpu::CullMode::None
+      .cullMode = wgpu::CullMode::Back
     },
     .depthStencil = &depthStencilState,
     .multisample = {
@@ -146,18 +198,43 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
     .fragment = &fragmentState,
 	};
 
-	m_pipeline = device.CreateRenderPipeline(&desc);
+	m_futures.push_back(CreatePipelineAsync(device, desc, m_pipeline));
+
+	// Both variants share the vertex stage, whose position output is
+	// invariant, so the prepass and the color pass agree on depth exactly.
+	wgpu::RenderPipelineDescriptor prepassDesc = desc;
+	prepassDesc.fragment = nullptr;
+
+	m_futures.push_back(
+		CreatePipelineAsync(device, prepassDesc, m_prepassPipeline));
+
+	wgpu::DepthStencilState equalDepthStencilState = depthStencilState;
+	equalDepthStencilState.depthWriteEnabled = false;
+	equalDepthStencilState.depthCompare = wgpu::CompareFunction::Equal;
+
+	wgpu::RenderPipelineDescriptor equalDesc = desc;
+	equalDesc.depthStencil = &equalDepthStencilState;
+
+	m_futures.push_back(
+		CreatePipelineAsync(device, equalDesc, m_equalPipeline));
 
 	auto &config = Config::Get();
-	int width = config.GetWidth();
-	int height = config.GetHeight();
+	Resize(device, config.GetWidth(), config.GetHeight());
+}
+
+void RenderPipeline::Resize(wgpu::Device &device, uint32_t width,
+			    uint32_t height)
+{
+	wgpu::TextureFormat depthStencilFormat = m_depthStencilFormat;
 
+	// Sampled by the depth pyramid build.
 	wgpu::TextureDescriptor depthStencilDesc = {
-    .usage = wgpu::TextureUsage::RenderAttachment,
+    .usage = wgpu::TextureUsage::RenderAttachment |
+             wgpu::TextureUsage::TextureBinding,
     .dimension = wgpu::TextureDimension::e2D,
     .size = {
-      .width = static_cast<uint32_t>(width),
-      .height = static_cast<uint32_t>(height),
+      .width = width,
+      .height = height,
       .depthOrArrayLayers = 1,
     },
     .format = depthStencilFormat,
@@ -182,10 +259,88 @@ void RenderPipeline::Create(wgpu::Device &device, const char *src,
 	m_depthStencilView = m_depthStencil.CreateView(&depthStencilViewDesc);
 }
 
+wgpu::RenderBundleEncoder
+RenderPipeline::CreateBundleEncoder(wgpu::Device &device)
+{
+	wgpu::RenderBundleEncoderDescriptor desc = {
+		.colorFormatCount = 1,
+		.colorFormats = &m_format,
+		.depthStencilFormat = m_depthStencilFormat,
+		.sampleCount = 1,
+		.depthReadOnly = false,
+		.stencilReadOnly = true,
+	};
+
+	return device.CreateRenderBundleEncoder(&desc);
+}
+
+void RenderPipeline::Wait(wgpu::Instance &instance)
+{
+	WaitForPipelines(instance, m_futures);
+}
+
 void RenderPipeline::Release()
 {
+	m_futures.clear();
 	m_depthStencilView = nullptr;
 	m_depthStencil = nullptr;
+	m_equalPipeline = nullptr;
+	m_prepassPipeline = nullptr;
+	m_pipeline = nullptr;
+	m_layout = nullptr;
+	m_bindGroupLayout = nullptr;
+}
+
+void ComputePipeline::Create(wgpu::Device &device, const char *src,
+			     const char *entryPoint,
+			     const std::vector<wgpu::BindGroupLayoutEntry> &entries)
+{
+	Release();
+
+	wgpu::BindGroupLayoutDescriptor bindGroupDesc = {
+		.entryCount = entries.size(),
+		.entries = entries.data(),
+	};
+
+	m_bindGroupLayout = device.CreateBindGroupLayout(&bindGroupDesc);
+
+	wgpu::PipelineLayoutDescriptor pipelineLayoutDesc = {
+		.bindGroupLayoutCount = 1,
+		.bindGroupLayouts = &m_bindGroupLayout,
+	};
+
+	m_layout = device.CreatePipelineLayout(&pipelineLayoutDesc);
+
+	wgpu::ShaderSourceWGSL wgsl({
+		.code = src,
+	});
+
+	wgpu::ShaderModuleDescriptor shaderModuleDesc = {
+		.nextInChain = &wgsl,
+	};
+
+	wgpu::ShaderModule module =
+		device.CreateShaderModule(&shaderModuleDesc);
+
+	wgpu::ComputePipelineDescriptor desc = {
+		.layout = m_layout,
+		.compute = {
+			.module = module,
+			.entryPoint = entryPoint,
+		},
+	};
+
+	m_futures.push_back(CreatePipelineAsync(device, desc, m_pipeline));
+}
+
+void ComputePipeline::Wait(wgpu::Instance &instance)
+{
+	WaitForPipelines(instance, m_futures);
+}
+
+void ComputePipeline::Release()
+{
+	m_futures.clear();
 	m_pipeline = nullptr;
 	m_layout = nullptr;
 	m_bindGroupLayout = nullptr;
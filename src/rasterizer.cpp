@@ -0,0 +1,388 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// Boxes are pushed outwards before testing, so faces lying on a box's
+// own sides never hide it.
+static const float kBoxMargin = 0.05f;
+
+void OcclusionRasterizer::Create(uint32_t width, uint32_t height)
+{
+	Release();
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = width / kTileWidth;
+	m_tilesY = height / kTileHeight;
+
+	m_depth.assign(width * height, 1.0f);
+	m_tileDepth.assign(m_tilesX * m_tilesY, 1.0f);
+}
+
+void OcclusionRasterizer::Release()
+{
+	m_occluders.clear();
+	m_depth.clear();
+	m_tileDepth.clear();
+
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+}
+
+void OcclusionRasterizer::Begin(const glm::mat4 &viewProj)
+{
+	m_viewProj = viewProj;
+	m_occluders.clear();
+}
+
+void OcclusionRasterizer::AddOccluder(const OccluderQuad &quad)
+{
+	glm::vec3 screen[4];
+
+	for (int i = 0; i < 4; i++) {
+		glm::vec4 clip = m_viewProj * glm::vec4(quad.corners[i], 1.0f);
+		if (clip.w <= 0.0f || clip.z < -clip.w) {
+			return;
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width,
+				      (0.5f - ndc.y * 0.5f) * m_height, ndc.z);
+	}
+
+	float area = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		const glm::vec3 &a = screen[i];
+		const glm::vec3 &b = screen[(i + 1) % 4];
+		area += a.x * b.y - b.x * a.y;
+	}
+
+	// Smaller than a pixel, nothing would be fully covered.
+	if (std::abs(area) < 2.0f) {
+		return;
+	}
+
+	float sign = area > 0.0f ? 1.0f : -1.0f;
+
+	Occluder occluder;
+
+	for (int i = 0; i < 4; i++) {
+		const glm::vec3 &a = screen[i];
+		const glm::vec3 &b = screen[(i + 1) % 4];
+
+		float ex = sign * (a.y - b.y);
+		float ey = sign * (b.x - a.x);
+
+		// Moved inwards by the pixel's extent along the edge normal, so
+		// only fully covered pixels pass.
+		occluder.edges[i][0] = ex;
+		occluder.edges[i][1] = ey;
+		occluder.edges[i][2] = -(ex * a.x + ey * a.y) -
+				       0.5f * (std::abs(ex) + std::abs(ey));
+	}
+
+	const glm::vec3 &p0 = screen[0];
+	glm::vec3 d1 = screen[1] - p0;
+	glm::vec3 d2 = screen[2] - p0;
+
+	float det = d1.x * d2.y - d2.x * d1.y;
+	if (std::abs(det) < 1e-6f) {
+		return;
+	}
+
+	float dzdx = (d1.z * d2.y - d2.z * d1.y) / det;
+	float dzdy = (d1.x * d2.z - d2.x * d1.z) / det;
+
+	// Farthest depth over the pixel rather than at its centre.
+	occluder.depth[0] = dzdx;
+	occluder.depth[1] = dzdy;
+	occluder.depth[2] = p0.z - dzdx * p0.x - dzdy * p0.y +
+			    0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+	glm::vec2 min(screen[0]), max(screen[0]);
+	for (int i = 1; i < 4; i++) {
+		min = glm::min(min, glm::vec2(screen[i]));
+		max = glm::max(max, glm::vec2(screen[i]));
+	}
+
+	occluder.minX = std::max(int(std::floor(min.x)), 0);
+	occluder.minY = std::max(int(std::floor(min.y)), 0);
+	occluder.maxX = std::min(int(std::ceil(max.x)), int(m_width) - 1);
+	occluder.maxY = std::min(int(std::ceil(max.y)), int(m_height) - 1);
+
+	if (occluder.minX > occluder.maxX || occluder.minY > occluder.maxY) {
+		return;
+	}
+
+	m_occluders.push_back(occluder);
+}
+
+void OcclusionRasterizer::Rasterize(WorkerPool &workers)
+{
+	workers.Run(m_tilesY,
+		    [this](uint32_t tileRow) { RasterizeBand(tileRow); });
+}
+
+void OcclusionRasterizer::RasterizeBand(uint32_t tileRow)
+{
+	int bandMinY = tileRow * kTileHeight;
+	int bandMaxY = bandMinY + kTileHeight - 1;
+
+	std::fill(m_depth.begin() + bandMinY * m_width,
+		  m_depth.begin() + (bandMaxY + 1) * m_width, 1.0f);
+
+	for (const Occluder &occluder : m_occluders) {
+		int minY = std::max(occluder.minY, bandMinY);
+		int maxY = std::min(occluder.maxY, bandMaxY);
+
+		// Whole steps of four pixels, the width is a multiple of four.
+		int minX = occluder.minX & ~3;
+		int maxX = std::min((occluder.maxX | 3) + 1, int(m_width));
+
+		const float(*e)[3] = occluder.edges;
+		const float *z = occluder.depth;
+
+		for (int y = minY; y <= maxY; y++) {
+			float py = y + 0.5f;
+
+			// Edge and depth values at the start of the row.
+			float r0 = e[0][1] * py + e[0][2];
+			float r1 = e[1][1] * py + e[1][2];
+			float r2 = e[2][1] * py + e[2][2];
+			float r3 = e[3][1] * py + e[3][2];
+			float rz = z[1] * py + z[2];
+
+			float *row = &GetDepth(0, y);
+
+#if defined(RASTER_SSE)
+			const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+
+			__m128 a0 = _mm_set1_ps(e[0][0]), c0 = _mm_set1_ps(r0);
+			__m128 a1 = _mm_set1_ps(e[1][0]), c1 = _mm_set1_ps(r1);
+			__m128 a2 = _mm_set1_ps(e[2][0]), c2 = _mm_set1_ps(r2);
+			__m128 a3 = _mm_set1_ps(e[3][0]), c3 = _mm_set1_ps(r3);
+			__m128 az = _mm_set1_ps(z[0]), cz = _mm_set1_ps(rz);
+
+			for (int x = minX; x < maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(float(x)),
+						       offsets);
+
+				__m128 in = _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(a0, px), c0), zero);
+				in = _mm_and_ps(in, _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(a1, px), c1), zero));
+				in = _mm_and_ps(in, _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(a2, px), c2), zero));
+				in = _mm_and_ps(in, _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(a3, px), c3), zero));
+
+				__m128 depth = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(
+					depth, _mm_add_ps(_mm_mul_ps(az, px), cz));
+
+				depth = _mm_or_ps(_mm_and_ps(in, nearer),
+						  _mm_andnot_ps(in, depth));
+				_mm_storeu_ps(row + x, depth);
+			}
+#elif defined(__wasm_simd128__)
+			const v128_t offsets =
+				wasm_f32x4_make(0.5f, 1.5f, 2.5f, 3.5f);
+			const v128_t zero = wasm_f32x4_splat(0.0f);
+
+			v128_t a0 = wasm_f32x4_splat(e[0][0]);
+			v128_t a1 = wasm_f32x4_splat(e[1][0]);
+			v128_t a2 = wasm_f32x4_splat(e[2][0]);
+			v128_t a3 = wasm_f32x4_splat(e[3][0]);
+			v128_t az = wasm_f32x4_splat(z[0]);
+			v128_t c0 = wasm_f32x4_splat(r0);
+			v128_t c1 = wasm_f32x4_splat(r1);
+			v128_t c2 = wasm_f32x4_splat(r2);
+			v128_t c3 = wasm_f32x4_splat(r3);
+			v128_t cz = wasm_f32x4_splat(rz);
+
+			for (int x = minX; x < maxX; x += 4) {
+				v128_t px = wasm_f32x4_add(
+					wasm_f32x4_splat(float(x)), offsets);
+
+				v128_t in = wasm_f32x4_ge(
+					wasm_f32x4_add(wasm_f32x4_mul(a0, px), c0),
+					zero);
+				in = wasm_v128_and(
+					in, wasm_f32x4_ge(wasm_f32x4_add(
+						wasm_f32x4_mul(a1, px), c1), zero));
+				in = wasm_v128_and(
+					in, wasm_f32x4_ge(wasm_f32x4_add(
+						wasm_f32x4_mul(a2, px), c2), zero));
+				in = wasm_v128_and(
+					in, wasm_f32x4_ge(wasm_f32x4_add(
+						wasm_f32x4_mul(a3, px), c3), zero));
+
+				v128_t depth = wasm_v128_load(row + x);
+				v128_t nearer = wasm_f32x4_min(
+					depth, wasm_f32x4_add(
+						wasm_f32x4_mul(az, px), cz));
+
+				depth = wasm_v128_bitselect(nearer, depth, in);
+				wasm_v128_store(row + x, depth);
+			}
+#else
+			for (int x = minX; x < maxX; x++) {
+				float px = x + 0.5f;
+
+				if (e[0][0] * px + r0 >= 0.0f &&
+				    e[1][0] * px + r1 >= 0.0f &&
+				    e[2][0] * px + r2 >= 0.0f &&
+				    e[3][0] * px + r3 >= 0.0f) {
+					row[x] = std::min(row[x], z[0] * px + rz);
+				}
+			}
+#endif
+		}
+	}
+
+	for (uint32_t tileX = 0; tileX < m_tilesX; tileX++) {
+		float farthest = 0.0f;
+
+		for (int y = bandMinY; y <= bandMaxY; y++) {
+			const float *row = &GetDepth(tileX * kTileWidth, y);
+			for (uint32_t x = 0; x < kTileWidth; x++) {
+				farthest = std::max(farthest, row[x]);
+			}
+		}
+
+		m_tileDepth[tileRow * m_tilesX + tileX] = farthest;
+	}
+}
+
+bool OcclusionRasterizer::IsOccluded(glm::vec3 min, glm::vec3 max) const
+{
+	min -= kBoxMargin;
+	max += kBoxMargin;
+
+	glm::vec2 screenMin(INFINITY), screenMax(-INFINITY);
+	float nearest = INFINITY;
+
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y,
+				 i & 4 ? max.z : min.z);
+
+		// Boxes reaching behind the near plane cannot be tested.
+		glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.0f);
+		if (clip.w <= 0.0f || clip.z < -clip.w) {
+			return false;
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen((ndc.x * 0.5f + 0.5f) * m_width,
+				 (0.5f - ndc.y * 0.5f) * m_height);
+
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		nearest = std::min(nearest, ndc.z);
+	}
+
+	// Every pixel the box touches.
+	int minX = std::max(int(std::floor(screenMin.x)), 0);
+	int minY = std::max(int(std::floor(screenMin.y)), 0);
+	int maxX = std::min(int(std::floor(screenMax.x)), int(m_width) - 1);
+	int maxY = std::min(int(std::floor(screenMax.y)), int(m_height) - 1);
+
+	if (minX > maxX || minY > maxY) {
+		return false;
+	}
+
+	for (int tileY = minY / kTileHeight; tileY <= maxY / int(kTileHeight);
+	     tileY++) {
+		for (int tileX = minX / kTileWidth;
+		     tileX <= maxX / int(kTileWidth); tileX++) {
+			if (m_tileDepth[tileY * m_tilesX + tileX] < nearest) {
+				continue;
+			}
+
+			int y0 = std::max(minY, tileY * int(kTileHeight));
+			int y1 = std::min(maxY, (tileY + 1) * int(kTileHeight) - 1);
+			int x0 = std::max(minX, tileX * int(kTileWidth));
+			int x1 = std::min(maxX, (tileX + 1) * int(kTileWidth) - 1);
+
+			for (int y = y0; y <= y1; y++) {
+				const float *row = &m_depth[y * m_width];
+				for (int x = x0; x <= x1; x++) {
+					if (row[x] >= nearest) {
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void OcclusionRasterizer::FindOccluders(const ChunkMesh &mesh,
+					glm::ivec3 origin, uint32_t minArea,
+					uint32_t maxCount,
+					std::vector<OccluderQuad> &occluders)
+{
+	occluders.clear();
+
+	// Area and first vertex of every large enough quad.
+	std::vector<std::pair<uint32_t, uint32_t> > candidates;
+
+	for (uint32_t quad = 0; quad < mesh.GetQuadCount(); quad++) {
+		glm::ivec3 corners[3];
+
+		for (int i = 0; i < 3; i++) {
+			uint32_t position = mesh.vertices[quad * 4 + i].position;
+			corners[i] = glm::ivec3(position & 0x3f,
+						(position >> 6) & 0x3f,
+						(position >> 12) & 0x3f);
+		}
+
+		// Quads are axis aligned, each side moves along one axis.
+		glm::ivec3 side0 = glm::abs(corners[1] - corners[0]);
+		glm::ivec3 side1 = glm::abs(corners[2] - corners[1]);
+		uint32_t area = (side0.x + side0.y + side0.z) *
+				(side1.x + side1.y + side1.z);
+
+		if (area >= minArea) {
+			candidates.push_back({ area, quad * 4 });
+		}
+	}
+
+	uint32_t count = std::min<size_t>(candidates.size(), maxCount);
+	std::partial_sort(candidates.begin(), candidates.begin() + count,
+			  candidates.end(), [](const auto &a, const auto &b) {
+				  return a.first > b.first;
+			  });
+
+	for (uint32_t i = 0; i < count; i++) {
+		OccluderQuad quad;
+
+		for (int corner = 0; corner < 4; corner++) {
+			uint32_t position =
+				mesh.vertices[candidates[i].second + corner]
+					.position;
+
+			// Blocks are centred on their integer coordinates.
+			quad.corners[corner] =
+				glm::vec3(origin) - 0.5f +
+				glm::vec3(position & 0x3f,
+					  (position >> 6) & 0x3f,
+					  (position >> 12) & 0x3f);
+		}
+
+		occluders.push_back(quad);
+	}
+}
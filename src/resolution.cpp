@@ -0,0 +1,353 @@
+#include "resolution.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+DEFINE_LOG_CATEGORY(Resolution);
+
+void DynamicResolution::Create(wgpu::Device &device, const char *src,
+			       wgpu::TextureFormat format, uint32_t width,
+			       uint32_t height, float targetFrameTime)
+{
+	Release();
+
+	m_format = format;
+	m_targetFrameTime = targetFrameTime;
+
+	// Explicit, so the target's bind group can be created before the
+	// pipeline is compiled.
+	wgpu::BindGroupLayoutEntry entries[2] = {
+    wgpu::BindGroupLayoutEntry {
+      .binding = 0,
+      .visibility = wgpu::ShaderStage::Fragment,
+      .texture = {
+        .sampleType = wgpu::TextureSampleType::Float,
+        .viewDimension = wgpu::TextureViewDimension::e2D,
+      },
+    },
+    wgpu::BindGroupLayoutEntry {
+      .binding = 1,
+      .visibility = wgpu::ShaderStage::Fragment,
+      .sampler = {
+        .type = wgpu::SamplerBindingType::Filtering,
+      },
+    }
+  };
+
+	wgpu::BindGroupLayoutDescriptor bindGroupDesc = {
+		.entryCount = 2,
+		.entries = entries,
+	};
+
+	m_bindGroupLayout = device.CreateBindGroupLayout(&bindGroupDesc);
+
+	wgpu::PipelineLayoutDescriptor pipelineLayoutDesc = {
+		.bindGroupLayoutCount = 1,
+		.bindGroupLayouts = &m_bindGroupLayout,
+	};
+
+	m_layout = device.CreatePipelineLayout(&pipelineLayoutDesc);
+
+	wgpu::ShaderSourceWGSL wgsl({
+		.code = src,
+	});
+
+	wgpu::ShaderModuleDescriptor shaderModuleDesc = {
+		.nextInChain = &wgsl,
+	};
+
+	wgpu::ShaderModule module =
+		device.CreateShaderModule(&shaderModuleDesc);
+
+	wgpu::ColorTargetState colorTargetState = {
+		.format = format,
+		.blend = nullptr,
+		.writeMask = wgpu::ColorWriteMask::All,
+	};
+
+	wgpu::FragmentState fragmentState = {
+		.module = module,
+		.entryPoint = "fs_main",
+		.constantCount = 0,
+		.constants = nullptr,
+		.targetCount = 1,
+		.targets = &colorTargetState,
+	};
+
+	// The triangle is generated from the vertex index, see blit.wgsl.
+	wgpu::RenderPipelineDescriptor desc = {
+    .layout = m_layout,
+		.vertex = {
+      .module = module,
+      .entryPoint = "vs_main",
+      .constantCount = 0,
+      .constants = nullptr,
+      .bufferCount = 0,
+      .buffers = nullptr,
+    },
+		.primitive = {
+      .topology = wgpu::PrimitiveTopology::TriangleList,
+      .stripIndexFormat = wgpu::IndexFormat::Undefined,
+      .frontFace = wgpu::FrontFace::CCW,
+      .cullMode = wgpu::CullMode::None
+    },
+    .depthStencil = nullptr,
+    .multisample = {
+      .count = 1,
+      .mask = ~0u,
+      .alphaToCoverageEnabled = false,
+    },
+    .fragment = &fragmentState,
+	};
+
+	m_futures.push_back(CreatePipelineAsync(device, desc, m_pipeline));
+
+	wgpu::SamplerDescriptor samplerDesc = {
+		.addressModeU = wgpu::AddressMode::ClampToEdge,
+		.addressModeV = wgpu::AddressMode::ClampToEdge,
+		.addressModeW = wgpu::AddressMode::ClampToEdge,
+		.magFilter = wgpu::FilterMode::Linear,
+		.minFilter = wgpu::FilterMode::Linear,
+		.mipmapFilter = wgpu::MipmapFilterMode::Nearest,
+	};
+
+	m_sampler = device.CreateSampler(&samplerDesc);
+
+	if (device.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+		wgpu::QuerySetDescriptor querySetDesc = {
+			.type = wgpu::QueryType::Timestamp,
+			.count = 2,
+		};
+
+		m_querySet = device.CreateQuerySet(&querySetDesc);
+
+		wgpu::BufferDescriptor resolveDesc = {
+			.usage = wgpu::BufferUsage::QueryResolve |
+				 wgpu::BufferUsage::CopySrc,
+			.size = 2 * sizeof(uint64_t),
+		};
+
+		m_resolveBuffer = device.CreateBuffer(&resolveDesc);
+
+		m_ring.Create(device, kReadbackCount, 2 * sizeof(uint64_t));
+
+		m_beginWrites = {
+			.querySet = m_querySet,
+			.beginningOfPassWriteIndex = 0,
+		};
+
+		m_endWrites = {
+			.querySet = m_querySet,
+			.endOfPassWriteIndex = 1,
+		};
+	}
+
+	SetOutputSize(width, height);
+	Update(device);
+}
+
+void DynamicResolution::Wait(wgpu::Instance &instance)
+{
+	WaitForPipelines(instance, m_futures);
+}
+
+void DynamicResolution::Release()
+{
+	m_ring.Release();
+
+	m_beginWrites = {};
+	m_endWrites = {};
+	m_resolveBuffer = nullptr;
+	m_querySet = nullptr;
+
+	m_bindGroup = nullptr;
+	m_view = nullptr;
+	m_texture = nullptr;
+
+	m_sampler = nullptr;
+	m_futures.clear();
+	m_pipeline = nullptr;
+	m_layout = nullptr;
+	m_bindGroupLayout = nullptr;
+
+	m_width = 0;
+	m_height = 0;
+	m_scale = 1.0f;
+	m_samples = 0;
+}
+
+void DynamicResolution::SetOutputSize(uint32_t width, uint32_t height)
+{
+	m_outputWidth = width;
+	m_outputHeight = height;
+
+	// Frame times at the old size say little about the new one.
+	m_samples = 0;
+}
+
+void DynamicResolution::SetEnabled(bool enabled)
+{
+	m_enabled = enabled;
+	m_scale = 1.0f;
+	m_samples = 0;
+}
+
+bool DynamicResolution::Update(wgpu::Device &device)
+{
+	uint32_t width = std::max<uint32_t>(
+		std::lround(m_outputWidth * m_scale), 1);
+	uint32_t height = std::max<uint32_t>(
+		std::lround(m_outputHeight * m_scale), 1);
+
+	if (width == m_width && height == m_height) {
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	CreateTarget(device);
+
+	LOG_DEBUG(Resolution, "Render size: {}x{} ({:.0f}%)", width, height,
+		  m_scale * 100.0f);
+
+	return true;
+}
+
+bool DynamicResolution::Begin()
+{
+	return m_ring.Begin();
+}
+
+const wgpu::PassTimestampWrites *DynamicResolution::GetTimestampWrites() const
+{
+	return m_ring.IsActive() ? &m_beginWrites : nullptr;
+}
+
+void DynamicResolution::Blit(wgpu::CommandEncoder &encoder,
+			     const wgpu::TextureView &output)
+{
+	// Every pixel is written, the clear only avoids loading the old ones.
+	wgpu::RenderPassColorAttachment attachment = {
+		.view = output,
+		.loadOp = wgpu::LoadOp::Clear,
+		.storeOp = wgpu::StoreOp::Store,
+		.clearValue = { .r = 0.0f, .g = 0.0f, .b = 0.0f, .a = 1.0f },
+	};
+
+	wgpu::RenderPassDescriptor renderPassDesc = {
+		.colorAttachmentCount = 1,
+		.colorAttachments = &attachment,
+		.depthStencilAttachment = nullptr,
+		.occlusionQuerySet = nullptr,
+		.timestampWrites = m_ring.IsActive() ? &m_endWrites : nullptr,
+	};
+
+	wgpu::RenderPassEncoder pass = encoder.BeginRenderPass(&renderPassDesc);
+	pass.SetPipeline(m_pipeline);
+	pass.SetBindGroup(0, m_bindGroup);
+	pass.Draw(3);
+	pass.End();
+}
+
+void DynamicResolution::Resolve(wgpu::CommandEncoder &encoder)
+{
+	if (!m_ring.IsActive()) {
+		return;
+	}
+
+	encoder.ResolveQuerySet(m_querySet, 0, 2, m_resolveBuffer, 0);
+	encoder.CopyBufferToBuffer(m_resolveBuffer, 0, m_ring.GetBuffer(), 0,
+				   2 * sizeof(uint64_t));
+}
+
+void DynamicResolution::Read()
+{
+	if (!m_ring.IsActive()) {
+		return;
+	}
+
+	m_ring.Read(2 * sizeof(uint64_t), [this](const void *data) {
+		const uint64_t *timestamps = static_cast<const uint64_t *>(data);
+
+		// Timestamps are in nanoseconds, and may go backwards when the
+		// GPU changes clocks.
+		if (timestamps[1] > timestamps[0]) {
+			AddSample((timestamps[1] - timestamps[0]) / 1e6f);
+		}
+	});
+}
+
+void DynamicResolution::CreateTarget(wgpu::Device &device)
+{
+	wgpu::TextureDescriptor textureDesc = {
+    .usage = wgpu::TextureUsage::RenderAttachment |
+             wgpu::TextureUsage::TextureBinding,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {
+      .width = m_width,
+      .height = m_height,
+      .depthOrArrayLayers = 1,
+    },
+    .format = m_format,
+    .mipLevelCount = 1,
+    .sampleCount = 1,
+  };
+
+	m_texture = device.CreateTexture(&textureDesc);
+	m_view = m_texture.CreateView();
+
+	wgpu::BindGroupEntry entries[2] = {
+		{
+			.binding = 0,
+			.textureView = m_view,
+		},
+		{
+			.binding = 1,
+			.sampler = m_sampler,
+		},
+	};
+
+	wgpu::BindGroupDescriptor bindGroupDesc = {
+		.layout = m_bindGroupLayout,
+		.entryCount = 2,
+		.entries = entries,
+	};
+
+	m_bindGroup = device.CreateBindGroup(&bindGroupDesc);
+}
+
+void DynamicResolution::AddSample(float frameTime)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	m_frameTime = m_samples == 0 ? frameTime :
+				       m_frameTime + (frameTime - m_frameTime) * 0.1f;
+	m_samples++;
+
+	if (m_samples < kSettleFrames) {
+		return;
+	}
+
+	// GPU time grows about with the pixel count, the scale only goes up
+	// when the next step is expected to stay within the target.
+	float scale = m_scale;
+	float up = std::min(m_scale + kScaleStep, 1.0f);
+
+	if (m_frameTime > m_targetFrameTime) {
+		scale = std::max(m_scale - kScaleStep, kMinScale);
+	} else if (m_frameTime * (up * up) / (m_scale * m_scale) <
+		   m_targetFrameTime) {
+		scale = up;
+	}
+
+	if (scale != m_scale) {
+		LOG_DEBUG(Resolution, "GPU time {:.2f} ms, scale {:.0f}%",
+			  m_frameTime, scale * 100.0f);
+
+		m_scale = scale;
+		m_samples = 0;
+	}
+}
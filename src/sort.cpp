@@ -0,0 +1,27 @@
+#include "sort.h"
+
+void RadixSort16(std::vector<uint32_t> &values, std::vector<uint32_t> &scratch)
+{
+	scratch.resize(values.size());
+
+	for (int shift = 16; shift < 32; shift += 8) {
+		uint32_t offsets[256] = {};
+
+		for (uint32_t value : values) {
+			offsets[(value >> shift) & 0xff]++;
+		}
+
+		uint32_t first = 0;
+		for (uint32_t &offset : offsets) {
+			uint32_t count = offset;
+			offset = first;
+			first += count;
+		}
+
+		for (uint32_t value : values) {
+			scratch[offsets[(value >> shift) & 0xff]++] = value;
+		}
+
+		values.swap(scratch);
+	}
+}
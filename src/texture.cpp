@@ -1,22 +1,34 @@
 #include "texture.h"
+#include "pipeline.h"
 
 #include "webgpu/webgpu_cpp.h"
-#include <glm/glm.hpp>
 
-void Texture::Create(wgpu::Device &device, void *data, int width, int height)
+#include <algorithm>
+
+void Texture::Create(wgpu::Device &device, const char *mipSrc, uint32_t width,
+		     uint32_t height, uint32_t layerCount)
 {
 	Release();
 
+	m_device = device;
+	m_width = width;
+	m_height = height;
+	m_layerCount = layerCount;
+
+	m_mipCount = CountMips(width, height);
+	m_dirty.assign(layerCount, 0);
+
 	wgpu::TextureDescriptor textureDesc = {
-    .usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding,
+    .usage = wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::TextureBinding |
+             wgpu::TextureUsage::RenderAttachment,
     .dimension = wgpu::TextureDimension::e2D,
     .size = {
-      .width = static_cast<uint32_t>(width),
-      .height = static_cast<uint32_t>(height),
-      .depthOrArrayLayers = 1,
+      .width = width,
+      .height = height,
+      .depthOrArrayLayers = layerCount,
     },
-    .format = wgpu::TextureFormat::RGBA8Unorm,
-    .mipLevelCount = 1,
+    .format = kFormat,
+    .mipLevelCount = m_mipCount,
     .sampleCount = 1,
     .viewFormatCount = 0,
     .viewFormats = nullptr,
@@ -24,42 +36,236 @@ void Texture::Create(wgpu::Device &device, void *data, int width, int height)
 
 	m_texture = device.CreateTexture(&textureDesc);
 
+	wgpu::TextureViewDescriptor viewDesc = {
+		.format = kFormat,
+		.dimension = wgpu::TextureViewDimension::e2DArray,
+		.baseMipLevel = 0,
+		.mipLevelCount = m_mipCount,
+		.baseArrayLayer = 0,
+		.arrayLayerCount = layerCount,
+		.aspect = wgpu::TextureAspect::All,
+	};
+
+	m_view = m_texture.CreateView(&viewDesc);
+
+	// Texels stay sharp up close, and blend between levels at distance.
+	wgpu::SamplerDescriptor samplerDesc = {
+		.addressModeU = wgpu::AddressMode::Repeat,
+		.addressModeV = wgpu::AddressMode::Repeat,
+		.addressModeW = wgpu::AddressMode::Repeat,
+		.magFilter = wgpu::FilterMode::Nearest,
+		.minFilter = wgpu::FilterMode::Linear,
+		.mipmapFilter = wgpu::MipmapFilterMode::Linear,
+	};
+
+	m_sampler = device.CreateSampler(&samplerDesc);
+
+	if (!mipSrc) {
+		return;
+	}
+
+	wgpu::SamplerDescriptor mipSamplerDesc = {
+		.addressModeU = wgpu::AddressMode::ClampToEdge,
+		.addressModeV = wgpu::AddressMode::ClampToEdge,
+		.addressModeW = wgpu::AddressMode::ClampToEdge,
+		.magFilter = wgpu::FilterMode::Linear,
+		.minFilter = wgpu::FilterMode::Linear,
+		.mipmapFilter = wgpu::MipmapFilterMode::Nearest,
+	};
+
+	m_mipSampler = device.CreateSampler(&mipSamplerDesc);
+
+	wgpu::ShaderSourceWGSL wgsl({
+		.code = mipSrc,
+	});
+
+	wgpu::ShaderModuleDescriptor shaderModuleDesc = {
+		.nextInChain = &wgsl,
+	};
+
+	wgpu::ShaderModule module =
+		device.CreateShaderModule(&shaderModuleDesc);
+
+	wgpu::ColorTargetState colorTargetState = {
+		.format = kFormat,
+		.blend = nullptr,
+		.writeMask = wgpu::ColorWriteMask::All,
+	};
+
+	wgpu::FragmentState fragmentState = {
+		.module = module,
+		.entryPoint = "fs_main",
+		.constantCount = 0,
+		.constants = nullptr,
+		.targetCount = 1,
+		.targets = &colorTargetState,
+	};
+
+	// The triangle is generated from the vertex index, see mipmap.wgsl.
+	wgpu::RenderPipelineDescriptor desc = {
+    .layout = nullptr,
+		.vertex = {
+      .module = module,
+      .entryPoint = "vs_main",
+      .constantCount = 0,
+      .constants = nullptr,
+      .bufferCount = 0,
+      .buffers = nullptr,
+    },
+		.primitive = {
+      .topology = wgpu::PrimitiveTopology::TriangleList,
+      .stripIndexFormat = wgpu::IndexFormat::Undefined,
+      .frontFace = wgpu::FrontFace::CCW,
+      .cullMode = wgpu::CullMode::None
+    },
+    .depthStencil = nullptr,
+    .multisample = {
+      .count = 1,
+      .mask = ~0u,
+      .alphaToCoverageEnabled = false,
+    },
+    .fragment = &fragmentState,
+	};
+
+	m_futures.push_back(CreatePipelineAsync(device, desc, m_mipPipeline));
+}
+
+void Texture::Wait(wgpu::Instance &instance)
+{
+	WaitForPipelines(instance, m_futures);
+}
+
+uint32_t Texture::CountMips(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while ((std::max(width, height) >> count) > 0) {
+		count++;
+	}
+
+	return count;
+}
+
+void Texture::Release()
+{
+	m_futures.clear();
+	m_mipSampler = nullptr;
+	m_mipPipeline = nullptr;
+
+	m_sampler = nullptr;
+	m_view = nullptr;
+	m_texture = nullptr;
+	m_device = nullptr;
+
+	m_dirty.clear();
+	m_dirtyCount = 0;
+	m_layerCount = 0;
+	m_mipCount = 0;
+}
+
+void Texture::UploadLayer(Uploader &uploader, uint32_t layer, const void *data)
+{
+	uint64_t ticket = UploadLevel(uploader, layer, 0, data);
+
+	// Only created along with the mip pipeline, which may still compile.
+	if (m_mipSampler && m_mipCount > 1) {
+		if (!m_dirty[layer]) {
+			m_dirtyCount++;
+		}
+
+		m_dirty[layer] = ticket;
+	}
+}
+
+uint64_t Texture::UploadLevel(Uploader &uploader, uint32_t layer,
+			      uint32_t level, const void *data)
+{
 	wgpu::TexelCopyTextureInfo destination = {
     .texture = m_texture,
-    .mipLevel = 0,
+    .mipLevel = level,
     .origin = {
       .x = 0,
       .y = 0,
-      .z = 0,
+      .z = layer,
     },
     .aspect = wgpu::TextureAspect::All,
 	};
 
-	wgpu::TexelCopyBufferLayout source = {
-		.offset = 0,
-		.bytesPerRow = 4 * textureDesc.size.width,
-		.rowsPerImage = textureDesc.size.height,
+	wgpu::Extent3D size = {
+		.width = std::max(m_width >> level, 1u),
+		.height = std::max(m_height >> level, 1u),
+		.depthOrArrayLayers = 1,
 	};
 
-	device.GetQueue().WriteTexture(&destination, data,
-				       width * height * sizeof(glm::vec4),
-				       &source, &textureDesc.size);
+	return uploader.UploadTexture(destination, data, 4 * size.width, size);
+}
+
+void Texture::GenerateMips(const Uploader &uploader,
+			   wgpu::CommandEncoder &encoder)
+{
+	wgpu::BindGroupLayout layout = m_mipPipeline.GetBindGroupLayout(0);
+
+	for (uint32_t layer = 0; layer < m_layerCount; layer++) {
+		if (!m_dirty[layer] || !uploader.IsStaged(m_dirty[layer])) {
+			continue;
+		}
+
+		for (uint32_t level = 1; level < m_mipCount; level++) {
+			wgpu::BindGroupEntry entries[2] = {
+				{
+					.binding = 0,
+					.textureView =
+						CreateLevelView(level - 1, layer),
+				},
+				{
+					.binding = 1,
+					.sampler = m_mipSampler,
+				},
+			};
+
+			wgpu::BindGroupDescriptor bindGroupDesc = {
+				.layout = layout,
+				.entryCount = 2,
+				.entries = entries,
+			};
+
+			wgpu::BindGroup bindGroup =
+				m_device.CreateBindGroup(&bindGroupDesc);
+
+			wgpu::RenderPassColorAttachment attachment = {
+				.view = CreateLevelView(level, layer),
+				.loadOp = wgpu::LoadOp::Clear,
+				.storeOp = wgpu::StoreOp::Store,
+			};
 
+			wgpu::RenderPassDescriptor renderPassDesc = {
+				.colorAttachmentCount = 1,
+				.colorAttachments = &attachment,
+			};
+
+			wgpu::RenderPassEncoder pass =
+				encoder.BeginRenderPass(&renderPassDesc);
+			pass.SetPipeline(m_mipPipeline);
+			pass.SetBindGroup(0, bindGroup);
+			pass.Draw(3);
+			pass.End();
+		}
+
+		m_dirty[layer] = 0;
+		m_dirtyCount--;
+	}
+}
+
+wgpu::TextureView Texture::CreateLevelView(uint32_t level, uint32_t layer)
+{
 	wgpu::TextureViewDescriptor viewDesc = {
-		.format = textureDesc.format,
+		.format = kFormat,
 		.dimension = wgpu::TextureViewDimension::e2D,
-		.baseMipLevel = 0,
+		.baseMipLevel = level,
 		.mipLevelCount = 1,
-		.baseArrayLayer = 0,
+		.baseArrayLayer = layer,
 		.arrayLayerCount = 1,
 		.aspect = wgpu::TextureAspect::All,
 	};
 
-	m_view = m_texture.CreateView(&viewDesc);
-}
-
-void Texture::Release()
-{
-	m_view = nullptr;
-	m_texture = nullptr;
+	return m_texture.CreateView(&viewDesc);
 }
@@ -0,0 +1,381 @@
+#include "upload.h"
+
+#include <algorithm>
+#include <cstring>
+
+DEFINE_LOG_CATEGORY(Upload);
+
+void Uploader::Create(wgpu::Device &device, uint64_t pageSize,
+		      uint64_t frameBudget)
+{
+	Release();
+
+	m_device = device;
+	m_pageSize = pageSize;
+	m_frameBudget = frameBudget;
+}
+
+void Uploader::Release()
+{
+	m_deferred.clear();
+	m_bufferCopies.clear();
+	m_textureCopies.clear();
+
+	m_current = nullptr;
+	m_used.clear();
+	m_free.clear();
+	m_pages.clear();
+
+	m_frameBytes = 0;
+	m_pendingBytes = 0;
+	m_ticket = 0;
+	m_stagedTicket = 0;
+
+	m_device = nullptr;
+}
+
+bool Uploader::HasBudget(uint64_t size) const
+{
+	return m_frameBytes == 0 || m_frameBytes + size <= m_frameBudget;
+}
+
+uint64_t Uploader::Upload(const wgpu::Buffer &buffer, uint64_t offset,
+			  const void *data, uint64_t size)
+{
+	LOG_CRITICAL_IF(Upload, offset % 4 != 0 || size % 4 != 0,
+			"Unaligned buffer upload of {} bytes at {}!", size,
+			offset);
+
+	// Nothing to wait for beyond the uploads before it.
+	if (size == 0) {
+		return m_ticket;
+	}
+
+	uint64_t ticket = ++m_ticket;
+
+	if (!m_deferred.empty() || !HasBudget(size)) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+		m_deferred.push_back(Deferred{
+			.ticket = ticket,
+			.isTexture = false,
+			.buffer = buffer,
+			.offset = offset,
+			.data = std::vector<uint8_t>(bytes, bytes + size),
+		});
+		m_pendingBytes += size;
+		return ticket;
+	}
+
+	StageBuffer(buffer, offset, data, size);
+	m_stagedTicket = ticket;
+	return ticket;
+}
+
+uint64_t Uploader::UploadTexture(const wgpu::TexelCopyTextureInfo &destination,
+				 const void *data, uint32_t bytesPerRow,
+				 const wgpu::Extent3D &size)
+{
+	LOG_CRITICAL_IF(Upload, size.depthOrArrayLayers != 1,
+			"Texture uploads are limited to a single layer!");
+
+	uint64_t byteCount = uint64_t(bytesPerRow) * size.height;
+	uint64_t ticket = ++m_ticket;
+
+	if (!m_deferred.empty() || !HasBudget(byteCount)) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+		m_deferred.push_back(Deferred{
+			.ticket = ticket,
+			.isTexture = true,
+			.texture = destination,
+			.bytesPerRow = bytesPerRow,
+			.size = size,
+			.data = std::vector<uint8_t>(bytes, bytes + byteCount),
+		});
+		m_pendingBytes += byteCount;
+		return ticket;
+	}
+
+	StageTexture(destination, data, bytesPerRow, size);
+	m_stagedTicket = ticket;
+	return ticket;
+}
+
+Uploader::Page *Uploader::Allocate(uint64_t size, uint64_t alignment,
+				   uint64_t &offset)
+{
+	if (m_current) {
+		offset = Align(m_current->used, alignment);
+		if (offset + size <= m_current->size) {
+			m_current->used = offset + size;
+			return m_current;
+		}
+	}
+
+	m_current = nullptr;
+
+	for (size_t i = 0; i < m_free.size(); i++) {
+		if (m_free[i]->size >= size) {
+			m_current = m_free[i];
+			m_free.erase(m_free.begin() + i);
+			break;
+		}
+	}
+
+	if (!m_current) {
+		auto page = std::make_unique<Page>();
+		page->size = std::max(m_pageSize, Align(size, 4));
+
+		wgpu::BufferDescriptor desc = {
+			.usage = wgpu::BufferUsage::MapWrite |
+				 wgpu::BufferUsage::CopySrc,
+			.size = page->size,
+			.mappedAtCreation = true,
+		};
+
+		page->buffer = m_device.CreateBuffer(&desc);
+		page->mapped =
+			static_cast<uint8_t *>(page->buffer.GetMappedRange());
+
+		LOG_DEBUG(Upload, "Allocated staging page {} of {} bytes",
+			  m_pages.size(), page->size);
+
+		m_current = page.get();
+		m_pages.push_back(std::move(page));
+	}
+
+	m_current->used = size;
+	m_used.push_back(m_current);
+
+	offset = 0;
+	return m_current;
+}
+
+void Uploader::StageBuffer(const wgpu::Buffer &buffer, uint64_t offset,
+			   const void *data, uint64_t size)
+{
+	uint64_t srcOffset;
+	Page *page = Allocate(size, 4, srcOffset);
+
+	std::memcpy(page->mapped + srcOffset, data, size);
+	m_frameBytes += size;
+
+	if (!m_bufferCopies.empty()) {
+		BufferCopy &last = m_bufferCopies.back();
+
+		if (last.page == page && last.dst.Get() == buffer.Get() &&
+		    last.srcOffset + last.size == srcOffset &&
+		    last.dstOffset + last.size == offset) {
+			last.size += size;
+			return;
+		}
+	}
+
+	m_bufferCopies.push_back(BufferCopy{
+		.page = page,
+		.srcOffset = srcOffset,
+		.dst = buffer,
+		.dstOffset = offset,
+		.size = size,
+	});
+}
+
+void Uploader::StageTexture(const wgpu::TexelCopyTextureInfo &destination,
+			    const void *data, uint32_t bytesPerRow,
+			    const wgpu::Extent3D &size)
+{
+	// Buffer to texture copies need rows 256 byte aligned in the staging
+	// page, so rows are repacked on the way in.
+	uint32_t stagedBytesPerRow = Align(bytesPerRow, 256);
+	uint64_t stagedSize = uint64_t(stagedBytesPerRow) * size.height;
+
+	uint64_t srcOffset;
+	Page *page = Allocate(stagedSize, 256, srcOffset);
+
+	const uint8_t *src = static_cast<const uint8_t *>(data);
+	for (uint32_t row = 0; row < size.height; row++) {
+		std::memcpy(page->mapped + srcOffset + row * stagedBytesPerRow,
+			    src + uint64_t(row) * bytesPerRow, bytesPerRow);
+	}
+
+	m_frameBytes += stagedSize;
+
+	m_textureCopies.push_back(TextureCopy{
+		.page = page,
+		.srcOffset = srcOffset,
+		.bytesPerRow = stagedBytesPerRow,
+		.dst = destination,
+		.size = size,
+	});
+}
+
+void Uploader::Submit()
+{
+	while (!m_deferred.empty()) {
+		Deferred &upload = m_deferred.front();
+
+		uint64_t size = upload.data.size();
+		if (!HasBudget(size)) {
+			break;
+		}
+
+		if (upload.isTexture) {
+			StageTexture(upload.texture, upload.data.data(),
+				     upload.bytesPerRow, upload.size);
+		} else {
+			StageBuffer(upload.buffer, upload.offset,
+				    upload.data.data(), size);
+		}
+
+		m_pendingBytes -= size;
+		m_stagedTicket = upload.ticket;
+		m_deferred.pop_front();
+	}
+
+	m_frameBytes = 0;
+
+	if (m_used.empty()) {
+		return;
+	}
+
+	for (Page *page : m_used) {
+		page->buffer.Unmap();
+		page->mapped = nullptr;
+	}
+
+	wgpu::CommandEncoder encoder = m_device.CreateCommandEncoder();
+
+	for (const BufferCopy &copy : m_bufferCopies) {
+		encoder.CopyBufferToBuffer(copy.page->buffer, copy.srcOffset,
+					   copy.dst, copy.dstOffset, copy.size);
+	}
+
+	for (const TextureCopy &copy : m_textureCopies) {
+		wgpu::TexelCopyBufferInfo source = {
+			.layout = {
+				.offset = copy.srcOffset,
+				.bytesPerRow = copy.bytesPerRow,
+				.rowsPerImage = copy.size.height,
+			},
+			.buffer = copy.page->buffer,
+		};
+
+		encoder.CopyBufferToTexture(&source, &copy.dst, &copy.size);
+	}
+
+	wgpu::CommandBuffer commands = encoder.Finish();
+	m_device.GetQueue().Submit(1, &commands);
+
+	m_bufferCopies.clear();
+	m_textureCopies.clear();
+
+	for (Page *page : m_used) {
+		Recycle(page);
+	}
+
+	m_used.clear();
+	m_current = nullptr;
+}
+
+void Uploader::Recycle(Page *page)
+{
+	page->buffer.MapAsync(
+		wgpu::MapMode::Write, 0, page->size,
+		wgpu::CallbackMode::AllowProcessEvents,
+		[this, page](wgpu::MapAsyncStatus status,
+			     wgpu::StringView message) {
+			if (status != wgpu::MapAsyncStatus::Success) {
+				LOG_WARN_IF(
+					Upload,
+					status != wgpu::MapAsyncStatus::Aborted,
+					"MapAsync: {}", message);
+				return;
+			}
+
+			page->used = 0;
+			page->mapped = static_cast<uint8_t *>(
+				page->buffer.GetMappedRange());
+
+			m_free.push_back(page);
+		});
+}
+
+void ReadbackRing::Create(wgpu::Device &device, uint32_t count, uint64_t size)
+{
+	Release();
+
+	for (uint32_t i = 0; i < count; i++) {
+		auto entry = std::make_unique<Entry>();
+
+		wgpu::BufferDescriptor desc = {
+			.usage = wgpu::BufferUsage::MapRead |
+				 wgpu::BufferUsage::CopyDst,
+			.size = size,
+		};
+
+		entry->buffer = device.CreateBuffer(&desc);
+		entry->index = i;
+		m_entries.push_back(std::move(entry));
+	}
+}
+
+void ReadbackRing::Release()
+{
+	m_current = nullptr;
+	m_entries.clear();
+}
+
+bool ReadbackRing::Begin()
+{
+	m_current = nullptr;
+
+	for (auto &entry : m_entries) {
+		if (!entry->pending) {
+			m_current = entry.get();
+			break;
+		}
+	}
+
+	return m_current != nullptr;
+}
+
+void ReadbackRing::Read(uint64_t size,
+			std::function<void(const void *data)> read)
+{
+	Entry *entry = m_current;
+	m_current = nullptr;
+
+	if (!entry || size == 0) {
+		return;
+	}
+
+	entry->pending = true;
+
+	entry->buffer.MapAsync(
+		wgpu::MapMode::Read, 0, size,
+		wgpu::CallbackMode::AllowProcessEvents,
+		[entry, size, read = std::move(read)](wgpu::MapAsyncStatus status,
+						      wgpu::StringView message) {
+			// The buffer, and the entry with it, went away.
+			if (status == wgpu::MapAsyncStatus::Aborted ||
+			    status == wgpu::MapAsyncStatus::CallbackCancelled) {
+				return;
+			}
+
+			// Other failures give the buffer back for a later
+			// frame instead of losing it for good.
+			if (status == wgpu::MapAsyncStatus::Success) {
+				read(entry->buffer.GetConstMappedRange(0, size));
+			} else {
+				LOG_WARN(Upload, "MapAsync: {}", message);
+			}
+
+			if (entry->buffer.GetMapState() ==
+			    wgpu::BufferMapState::Mapped) {
+				entry->buffer.Unmap();
+			}
+
+			entry->pending = false;
+		});
+}
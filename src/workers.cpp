@@ -0,0 +1,144 @@
+#include "workers.h"
+
+void WorkerPool::Create(uint32_t threadCount)
+{
+	Release();
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	threadCount = 0;
+#endif
+
+	m_quit = false;
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+		m_threads.emplace_back(&WorkerPool::WorkerMain, this);
+	}
+}
+
+void WorkerPool::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_wake.notify_all();
+
+	for (std::thread &thread : m_threads) {
+		thread.join();
+	}
+
+	m_threads.clear();
+	m_tasks.clear();
+	m_pendingTasks = 0;
+}
+
+void WorkerPool::Run(uint32_t count, const std::function<void(uint32_t)> &job)
+{
+	if (m_threads.empty() || count <= 1) {
+		for (uint32_t i = 0; i < count; i++) {
+			job(i);
+		}
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &job;
+		m_count = count;
+		m_next = 0;
+		m_busy = m_threads.size();
+		m_generation++;
+	}
+
+	m_wake.notify_all();
+
+	Work();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busy == 0; });
+	m_job = nullptr;
+}
+
+void WorkerPool::Start(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+		m_pendingTasks++;
+	}
+
+	m_wake.notify_one();
+}
+
+void WorkerPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_tasks.empty()) {
+		RunTask(lock);
+	}
+
+	m_done.wait(lock, [this] { return m_pendingTasks == 0; });
+}
+
+void WorkerPool::RunTask(std::unique_lock<std::mutex> &lock)
+{
+	std::function<void()> task = std::move(m_tasks.front());
+	m_tasks.pop_front();
+
+	lock.unlock();
+	task();
+	lock.lock();
+
+	if (--m_pendingTasks == 0) {
+		m_done.notify_all();
+	}
+}
+
+void WorkerPool::WorkerMain()
+{
+	uint64_t generation = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, generation] {
+				return m_quit || m_generation != generation ||
+				       !m_tasks.empty();
+			});
+
+			if (m_quit) {
+				return;
+			}
+
+			// Loops come first, Run waits for every worker.
+			if (m_generation == generation) {
+				RunTask(lock);
+				continue;
+			}
+
+			generation = m_generation;
+		}
+
+		Work();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy == 0) {
+			m_done.notify_all();
+		}
+	}
+}
+
+void WorkerPool::Work()
+{
+	for (;;) {
+		uint32_t i = m_next.fetch_add(1);
+		if (i >= m_count) {
+			return;
+		}
+
+		(*m_job)(i);
+	}
+}
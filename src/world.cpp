@@ -0,0 +1,225 @@
+#include "world.h"
+
+#include <algorithm>
+
+DEFINE_LOG_CATEGORY(World);
+
+Chunk::Chunk(glm::ivec3 coord)
+	: m_coord(coord)
+{
+}
+
+void Chunk::SetBlock(int x, int y, int z, Block block)
+{
+	Block &current = m_blocks[GetBlockIdx(x, y, z)];
+	if (current == block) {
+		return;
+	}
+
+	uint32_t &column = m_columns[x * CHUNK_SIZE + z];
+
+	if (block != BLOCK_AIR) {
+		if (m_solidCount == 0) {
+			m_type = block;
+		} else if (block != m_type) {
+			m_mixed = true;
+		}
+	}
+
+	if (current == BLOCK_AIR) {
+		m_solidCount++;
+		column |= 1u << y;
+	} else if (block == BLOCK_AIR) {
+		m_solidCount--;
+		column &= ~(1u << y);
+
+		if (m_solidCount == 0) {
+			m_mixed = false;
+		}
+	}
+
+	current = block;
+	m_dirty = true;
+}
+
+uint64_t World::GetChunkKey(glm::ivec3 coord)
+{
+	const uint64_t mask = (1ull << 21) - 1;
+
+	return ((uint64_t(coord.x) & mask) << 42) |
+	       ((uint64_t(coord.y) & mask) << 21) | (uint64_t(coord.z) & mask);
+}
+
+static inline int FloorDiv(int a, int b)
+{
+	return (a >= 0) ? a / b : (a - b + 1) / b;
+}
+
+static inline int DistanceSq(glm::ivec3 d)
+{
+	return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+glm::ivec3 World::GetChunkCoord(glm::ivec3 pos)
+{
+	return { FloorDiv(pos.x, CHUNK_SIZE), FloorDiv(pos.y, CHUNK_SIZE),
+		 FloorDiv(pos.z, CHUNK_SIZE) };
+}
+
+glm::ivec3 World::GetLocalPos(glm::ivec3 pos)
+{
+	return pos - GetChunkCoord(pos) * CHUNK_SIZE;
+}
+
+void World::Update(glm::vec3 cameraPos)
+{
+	glm::ivec3 center = GetChunkCoord(glm::floor(cameraPos));
+
+	if (!m_centerValid || center != m_center) {
+		m_center = center;
+		m_centerValid = true;
+
+		for (auto it = m_chunks.begin(); it != m_chunks.end();) {
+			glm::ivec3 d = glm::abs(it->second->GetCoord() - center);
+			if (d.x > m_renderDistance + 1 ||
+			    d.z > m_renderDistance + 1 ||
+			    d.y > m_verticalDistance + 1) {
+				it = m_chunks.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		m_pending.clear();
+
+		for (int x = -m_renderDistance; x <= m_renderDistance; x++) {
+			for (int y = -m_verticalDistance;
+			     y <= m_verticalDistance; y++) {
+				for (int z = -m_renderDistance;
+				     z <= m_renderDistance; z++) {
+					glm::ivec3 coord =
+						center + glm::ivec3(x, y, z);
+					if (!GetChunk(coord)) {
+						m_pending.push_back(coord);
+					}
+				}
+			}
+		}
+
+		// Farthest first, so the nearest chunk is popped off the back.
+		std::sort(m_pending.begin(), m_pending.end(),
+			  [center](glm::ivec3 a, glm::ivec3 b) {
+				  return DistanceSq(a - center) >
+					 DistanceSq(b - center);
+			  });
+	}
+
+	for (int i = 0; i < m_loadBudget && !m_pending.empty(); i++) {
+		glm::ivec3 coord = m_pending.back();
+		m_pending.pop_back();
+
+		auto chunk = std::make_unique<Chunk>(coord);
+		Generate(*chunk);
+
+		m_chunks.emplace(GetChunkKey(coord), std::move(chunk));
+
+		// Neighbours meshed their shared border against air while this
+		// chunk was missing.
+		for (int axis = 0; axis < 3; axis++) {
+			for (int dir = -1; dir <= 1; dir += 2) {
+				glm::ivec3 offset(0);
+				offset[axis] = dir;
+
+				MarkDirty(coord + offset);
+			}
+		}
+	}
+}
+
+void World::MarkDirty(glm::ivec3 coord)
+{
+	Chunk *chunk = GetChunk(coord);
+	if (chunk) {
+		chunk->SetDirty(true);
+	}
+}
+
+void World::Release()
+{
+	m_pending.clear();
+	m_chunks.clear();
+	m_centerValid = false;
+}
+
+Chunk *World::GetChunk(glm::ivec3 coord) const
+{
+	auto it = m_chunks.find(GetChunkKey(coord));
+	if (it == m_chunks.end()) {
+		return nullptr;
+	}
+
+	return it->second.get();
+}
+
+Block World::GetBlock(glm::ivec3 pos) const
+{
+	Chunk *chunk = GetChunk(GetChunkCoord(pos));
+	if (!chunk) {
+		return BLOCK_AIR;
+	}
+
+	glm::ivec3 local = GetLocalPos(pos);
+	return chunk->GetBlock(local.x, local.y, local.z);
+}
+
+bool World::SetBlock(glm::ivec3 pos, Block block)
+{
+	Chunk *chunk = GetChunk(GetChunkCoord(pos));
+	if (!chunk) {
+		LOG_WARN(World, "SetBlock on unloaded chunk at ({}, {}, {})",
+			 pos.x, pos.y, pos.z);
+		return false;
+	}
+
+	glm::ivec3 local = GetLocalPos(pos);
+	chunk->SetBlock(local.x, local.y, local.z, block);
+
+	glm::ivec3 coord = chunk->GetCoord();
+	for (int axis = 0; axis < 3; axis++) {
+		glm::ivec3 offset(0);
+
+		if (local[axis] == 0) {
+			offset[axis] = -1;
+		} else if (local[axis] == CHUNK_SIZE - 1) {
+			offset[axis] = 1;
+		} else {
+			continue;
+		}
+
+		MarkDirty(coord + offset);
+	}
+
+	return true;
+}
+
+void World::Generate(Chunk &chunk)
+{
+	glm::ivec3 origin = chunk.GetOrigin();
+
+	if (origin.y >= 3 || origin.y + CHUNK_SIZE <= 0) {
+		return;
+	}
+
+	for (int x = 0; x < CHUNK_SIZE; x++) {
+		for (int y = 0; y < CHUNK_SIZE; y++) {
+			int worldY = origin.y + y;
+			if (worldY < 0 || worldY >= 3) {
+				continue;
+			}
+
+			for (int z = 0; z < CHUNK_SIZE; z++) {
+				chunk.SetBlock(x, y, z, BLOCK_COBBLESTONE);
+			}
+		}
+	}
+}
@@ -0,0 +1,163 @@
+// Asset cooker, run at build time. Decodes the block texture PNGs into a
+// cooked texture array with every mip level precomputed, so the game
+// uploads it as is instead of decoding at startup, see include/cooked.h.
+//
+// Usage: AssetCooker <output> <layer 0 png> [<layer 1 png> ...]
+
+#include "cooked.h"
+#include "logger.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+DEFINE_LOG_CATEGORY(Cooker);
+
+static float SrgbToLinear(uint8_t value)
+{
+	float c = value / 255.0f;
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t LinearToSrgb(float c)
+{
+	c = c <= 0.0031308f ? c * 12.92f :
+			      1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	return uint8_t(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Averages each 2x2 block of the source level in linear space, as the
+// sampler would with an sRGB view. Alpha is linear already. A side of 1
+// stays 1, its texels are repeated.
+static void Downsample(const std::vector<uint8_t> &src, uint32_t srcWidth,
+		       uint32_t srcHeight, std::vector<uint8_t> &dst)
+{
+	uint32_t width = std::max(srcWidth / 2, 1u);
+	uint32_t height = std::max(srcHeight / 2, 1u);
+
+	dst.resize(4 * width * height);
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			uint32_t x0 = std::min(2 * x, srcWidth - 1);
+			uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+			uint32_t y0 = std::min(2 * y, srcHeight - 1);
+			uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+
+			const uint8_t *texels[4] = {
+				&src[4 * (y0 * srcWidth + x0)],
+				&src[4 * (y0 * srcWidth + x1)],
+				&src[4 * (y1 * srcWidth + x0)],
+				&src[4 * (y1 * srcWidth + x1)],
+			};
+
+			uint8_t *out = &dst[4 * (y * width + x)];
+
+			for (int c = 0; c < 3; c++) {
+				float sum = 0.0f;
+				for (const uint8_t *texel : texels) {
+					sum += SrgbToLinear(texel[c]);
+				}
+
+				out[c] = LinearToSrgb(sum / 4.0f);
+			}
+
+			uint32_t alpha = 0;
+			for (const uint8_t *texel : texels) {
+				alpha += texel[3];
+			}
+
+			out[3] = uint8_t((alpha + 2) / 4);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		LOG_ERROR(Cooker, "Usage: {} <output> <png>...", argv[0]);
+		return 1;
+	}
+
+	const char *outputPath = argv[1];
+
+	// Matches the orientation the game loaded PNGs with.
+	stbi_set_flip_vertically_on_load(true);
+
+	CookedTextureHeader header = {
+		.magic = kCookedTextureMagic,
+		.version = kCookedTextureVersion,
+		.width = 0,
+		.height = 0,
+		.layerCount = uint32_t(argc - 2),
+		.mipCount = 1,
+	};
+
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> level;
+	std::vector<uint8_t> next;
+
+	for (int i = 2; i < argc; i++) {
+		int width, height, channels;
+		uint8_t *image = stbi_load(argv[i], &width, &height, &channels, 4);
+		if (!image) {
+			LOG_ERROR(Cooker, "Failed to load {}: {}", argv[i],
+				  stbi_failure_reason());
+			return 1;
+		}
+
+		if (i == 2) {
+			header.width = width;
+			header.height = height;
+
+			while ((std::max(header.width, header.height) >>
+				header.mipCount) > 0) {
+				header.mipCount++;
+			}
+		} else if (uint32_t(width) != header.width ||
+			   uint32_t(height) != header.height) {
+			LOG_ERROR(Cooker, "{} is {}x{}, the first layer is {}x{}",
+				  argv[i], width, height, header.width,
+				  header.height);
+			stbi_image_free(image);
+			return 1;
+		}
+
+		level.assign(image, image + 4 * width * height);
+		stbi_image_free(image);
+
+		for (uint32_t mip = 0; mip < header.mipCount; mip++) {
+			data.insert(data.end(), level.begin(), level.end());
+
+			if (mip + 1 < header.mipCount) {
+				Downsample(level, std::max(header.width >> mip, 1u),
+					   std::max(header.height >> mip, 1u),
+					   next);
+				level.swap(next);
+			}
+		}
+	}
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file) {
+		LOG_ERROR(Cooker, "Failed to open {}!", outputPath);
+		return 1;
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+	if (!file) {
+		LOG_ERROR(Cooker, "Failed to write {}!", outputPath);
+		return 1;
+	}
+
+	LOG_INFO(Cooker, "Cooked {} layers of {}x{} with {} levels into {}",
+		 header.layerCount, header.width, header.height,
+		 header.mipCount, outputPath);
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+// Asset packer, run at build time. Packs the given files into one asset
+// archive the game maps at startup, see include/archive.h. Assets are
+// named after their file name.
+//
+// Usage: AssetPacker <output> <file>...
+
+#include "archive.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+DEFINE_LOG_CATEGORY(Packer);
+
+struct PackedFile {
+	std::string name;
+	std::string path;
+};
+
+static bool ReadFile(const std::string &path, std::vector<char> &data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	data.assign(std::istreambuf_iterator<char>(file),
+		    std::istreambuf_iterator<char>());
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		LOG_ERROR(Packer, "Usage: {} <output> <file>...", argv[0]);
+		return 1;
+	}
+
+	const char *outputPath = argv[1];
+
+	std::vector<PackedFile> files;
+	for (int i = 2; i < argc; i++) {
+		std::string name =
+			std::filesystem::path(argv[i]).filename().string();
+
+		if (name.size() >= sizeof(ArchiveEntry::name)) {
+			LOG_ERROR(Packer, "Asset name {} is too long!", name);
+			return 1;
+		}
+
+		files.push_back({ name, argv[i] });
+	}
+
+	// The game looks assets up with a binary search.
+	std::sort(files.begin(), files.end(),
+		  [](const PackedFile &a, const PackedFile &b) {
+			  return a.name < b.name;
+		  });
+
+	for (size_t i = 1; i < files.size(); i++) {
+		if (files[i].name == files[i - 1].name) {
+			LOG_ERROR(Packer, "Asset {} is given twice!",
+				  files[i].name);
+			return 1;
+		}
+	}
+
+	ArchiveHeader header = {
+		.magic = kArchiveMagic,
+		.version = kArchiveVersion,
+		.entryCount = uint32_t(files.size()),
+		.reserved = 0,
+	};
+
+	std::vector<ArchiveEntry> entries(files.size());
+	std::vector<char> contents;
+	std::vector<char> data;
+
+	uint64_t offset = sizeof(ArchiveHeader) +
+			  entries.size() * sizeof(ArchiveEntry);
+
+	for (size_t i = 0; i < files.size(); i++) {
+		if (!ReadFile(files[i].path, data)) {
+			LOG_ERROR(Packer, "Failed to read {}!", files[i].path);
+			return 1;
+		}
+
+		uint64_t aligned = (offset + kArchiveAlignment - 1) /
+				   kArchiveAlignment * kArchiveAlignment;
+		contents.resize(contents.size() + (aligned - offset), 0);
+		offset = aligned;
+
+		ArchiveEntry &entry = entries[i];
+		std::memset(entry.name, 0, sizeof(entry.name));
+		std::memcpy(entry.name, files[i].name.data(),
+			    files[i].name.size());
+		entry.offset = offset;
+		entry.size = data.size();
+
+		contents.insert(contents.end(), data.begin(), data.end());
+		contents.push_back(0);
+		offset += data.size() + 1;
+	}
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file) {
+		LOG_ERROR(Packer, "Failed to open {}!", outputPath);
+		return 1;
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(entries.data()),
+		   entries.size() * sizeof(ArchiveEntry));
+	file.write(contents.data(), contents.size());
+
+	if (!file) {
+		LOG_ERROR(Packer, "Failed to write {}!", outputPath);
+		return 1;
+	}
+
+	LOG_INFO(Packer, "Packed {} assets into {}, {} bytes", files.size(),
+		 outputPath, offset);
+
+	return 0;
+}